@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+# Builds and runs the benchmarks in this directory. Extra arguments are passed
+# to the compiler, e.g., "./bench.sh -march=native".
+
+set -e -u
+
+here=$(dirname "$0")
+build=${BUILD_DIR:-$(mktemp -d)}
+flags="-Wall -pedantic -std=c++11 -O2 $* -I$here/../include"
+
+c++ $flags "$here/inline.cpp" "$here/inline-lib.cpp" -o "$build/inline-compiled" -lpthread
+c++ $flags -DLC_HEADER_ONLY "$here/inline.cpp" -o "$build/inline-header" -lpthread
+c++ $flags "$here/locks.cpp" -o "$build/locks" -lpthread
+c++ $flags "$here/latency.cpp" -o "$build/latency" -lpthread
+c++ $flags "$here/footprint.cpp" -o "$build/footprint" -lpthread
+c++ $flags -I"$here/../example" "$here/graph.cpp" -o "$build/graph" -lpthread
+c++ $flags "$here/oversubscribe.cpp" -o "$build/oversubscribe" -lpthread
+
+"$build/inline-compiled"
+"$build/inline-header"
+"$build/locks"
+"$build/latency"
+#(the default of 10M containers needs a lot of memory)
+"$build/footprint" 1000000
+"$build/graph"
+"$build/oversubscribe"
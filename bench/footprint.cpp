@@ -0,0 +1,218 @@
+/* This measures the memory used by containers, proxies, and auth. objects for
+ * each lock type. For each type, it creates a large number of containers, then
+ * holds a proxy for each of a subset of them at once. Lock types that require
+ * an auth. object use one whose bookkeeping grows with each lock it holds, so
+ * that bookkeeping is measured separately and subtracted from the proxy line:
+ * the auth. read-locks a set of bare ordered locks (i.e., without containers or
+ * proxies), and then the same number of bare unordered locks (order 0), which
+ * it only counts. Allocations are counted by replacing the global 'operator
+ * new', and the heap memory they use (including the allocator's overhead) is
+ * read with 'mallinfo2', which unlike resident memory isn't rounded to pages.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include footprint.cpp -o footprint -lpthread
+ *
+ * Usage: ./footprint [containers] [proxies] [auth. locks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "locking-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+
+static long container_count = 10000000;
+static long proxy_count     = 1000000;
+static long auth_count      = 100000;
+
+static std::atomic <long> allocations(0), allocated_bytes(0);
+
+
+void *operator new(size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  void *memory = malloc(size? size : 1);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+
+//(not inlined, since GCC mistakes the 'free' for a mismatch with 'new' otherwise)
+__attribute__((noinline)) void operator delete(void *memory) noexcept {
+  free(memory);
+}
+
+
+static long heap_bytes() {
+  //(large allocations are mapped separately, so they're counted separately)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+
+struct cost {
+  cost() : heap(0), count(0), bytes(0) {}
+
+  cost operator - (const cost &other) const {
+    cost result;
+    result.heap     = heap     - other.heap;
+    result.count    = count    - other.count;
+    result.bytes    = bytes    - other.bytes;
+    return result;
+  }
+
+  void print(const char *label) const {
+    fprintf(stdout, "  %-10s heap: %7.1f B  allocations: %5.2f (%7.1f B)\n", label,
+      heap, count, bytes);
+  }
+
+  double heap, count, bytes;
+};
+
+
+struct usage {
+  usage() : heap(heap_bytes()), count(allocations), bytes(allocated_bytes) {}
+
+  //(the change since construction, per object)
+  cost since(long objects) const {
+    usage now;
+    cost result;
+    result.heap     = (double) (now.heap     - heap)     / objects;
+    result.count    = (double) (now.count    - count)    / objects;
+    result.bytes    = (double) (now.bytes    - bytes)    / objects;
+    return result;
+  }
+
+  void print(const char *label, long objects) const {
+    this->since(objects).print(label);
+  }
+
+  long heap, count, bytes;
+};
+
+
+//(ordered locks need an order; the others don't take an argument)
+template <class Type, class Base>
+static Type *new_containers(long count, lc::ordered_lock <Base>*) {
+  //NOTE: placement new is used because the order differs for each container
+  Type *containers = static_cast <Type*> (operator new[](count * sizeof(Type)));
+  for (long i = 0; i < count; i++) new (containers + i) Type(0, i + 1);
+  return containers;
+}
+
+template <class Type>
+static Type *new_containers(long count, void*) {
+  Type *containers = static_cast <Type*> (operator new[](count * sizeof(Type)));
+  for (long i = 0; i < count; i++) new (containers + i) Type(0);
+  return containers;
+}
+
+//(an order of 0 means that the lock is unordered)
+template <class Type>
+static Type *new_ordered_locks(long count, bool ordered) {
+  Type *locks = static_cast <Type*> (operator new[](count * sizeof(Type)));
+  for (long i = 0; i < count; i++) new (locks + i) Type(ordered? i + 1 : 0);
+  return locks;
+}
+
+template <class Type>
+static void delete_objects(Type *objects, long count) {
+  for (long i = 0; i < count; i++) objects[i].~Type();
+  operator delete[](objects);
+}
+
+
+//(the cost of holding read locks on 'count' bare locks through one auth.)
+template <class Lock>
+static cost lock_bare(lc::lock_auth_base::auth_type auth, long count, bool ordered) {
+  Lock *locks = new_ordered_locks <Lock> (count, ordered);
+  usage before_locks;
+  for (long i = 0; i < count; i++) {
+    if (locks[i].lock(auth.get(), true, false) < 0) abort();
+  }
+  const cost locked = before_locks.since(count);
+  for (long i = 0; i < count; i++) locks[i].unlock(auth.get(), true);
+  delete_objects(locks, count);
+  return locked;
+}
+
+
+//(only the ordered auth. keeps state for each lock; the others just count them)
+template <class Container, class Base>
+static bool auth_bookkeeping(cost &result, lc::ordered_lock <Base>*) {
+  typedef lc::ordered_lock <Base> Lock;
+  result = lock_bare <Lock> (Container::new_auth(), auth_count, true) -
+           lock_bare <Lock> (Container::new_auth(), auth_count, false);
+  return true;
+}
+
+template <class Container>
+static bool auth_bookkeeping(cost&, void*) {
+  return false;
+}
+
+
+template <class Lock>
+static void run_lock(const char *name, bool needs_auth) {
+  typedef lc::locking_container <int, Lock> container;
+  fprintf(stdout, "%s: sizeof(container) = %zu, sizeof(proxy) = %zu\n", name,
+    sizeof(container), sizeof(typename container::write_proxy));
+
+  usage before_containers;
+  container *containers = new_containers <container> (container_count, (Lock*) NULL);
+  before_containers.print("container", container_count);
+
+  //(the auth.'s per-lock bookkeeping: the same locks, ordered vs. unordered)
+  cost auth_cost;
+  const bool has_bookkeeping = auth_bookkeeping <container> (auth_cost, (Lock*) NULL);
+
+  {
+    lc::lock_auth_base::auth_type auth(container::new_auth());
+    std::vector <typename container::read_proxy> proxies;
+    proxies.reserve(proxy_count);
+    usage before_proxies;
+    for (long i = 0; i < proxy_count && i < container_count; i++) {
+      //(a separate auth. object for each proxy would be counted as part of the proxy)
+      typename container::read_proxy proxy = needs_auth?
+        containers[i].get_read_auth(auth) : containers[i].get_read();
+      if (!proxy) abort();
+      proxies.push_back(proxy);
+    }
+    //NOTE: the auth.'s bookkeeping is part of the total if it was used
+    (before_proxies.since(proxies.size()) - auth_cost).print("proxy");
+  }
+  if (has_bookkeeping) auth_cost.print("auth lock");
+
+  delete_objects(containers, container_count);
+  //(return freed memory to the system so that it isn't reused by the next type)
+  malloc_trim(0);
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) container_count = atol(argv[1]);
+  if (argc > 2) proxy_count     = atol(argv[2]);
+  if (argc > 3) auth_count      = atol(argv[3]);
+  if (container_count < 1 || proxy_count < 1 || auth_count < 1) {
+    fprintf(stderr, "%s [containers] [proxies] [auth. locks]\n", argv[0]);
+    return 1;
+  }
+
+  fprintf(stdout, "%li containers, %li proxies, %li auth. locks; values are per object\n",
+    container_count, proxy_count, auth_count);
+
+  run_lock <lc::rw_lock>       ("rw_lock",        false);
+  run_lock <lc::r_lock>        ("r_lock",         false);
+  run_lock <lc::w_lock>        ("w_lock",         false);
+  run_lock <lc::dumb_lock>     ("dumb_lock",      false);
+  run_lock <lc::adaptive_lock> ("adaptive_lock",  false);
+  run_lock <lc::priority_lock> ("priority_lock",  false);
+  run_lock <lc::ordered_lock <lc::rw_lock> > ("ordered_lock<rw_lock>",  true);
+}
@@ -0,0 +1,266 @@
+/* This measures the graph from "../example/graph-multi.cpp" while it's being
+ * used and modified by several threads at once. There are three types of
+ * threads:
+ *
+ *   - Readers look up random nodes and read them.
+ *
+ *   - Traversers take random walks through the graph. To move, a traverser
+ *     locks the current node, copies its edges, unlocks it, and then picks one
+ *     of the copied edges, so that it never holds more than one node lock.
+ *
+ *   - Mutators connect and disconnect random pairs of nodes, and erase and
+ *     re-insert random nodes.
+ *
+ * Operations whose locks are rejected are counted and skipped. The benchmark
+ * runs once with unordered node locks, where locking multiple nodes relies on
+ * the graph's meta-lock, and once with ordered node locks. It reports the
+ * throughput of each type of thread, the rejection rates, and how long the
+ * meta-lock was held for writing.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include -I../example graph.cpp -o graph -lpthread
+ *
+ * Usage: ./graph [nodes] [edges per node] [readers] [traversers] [mutators] [seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+#include "graph.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define WALK_STEPS 16
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+//(a multi-lock that records how long it's held for writing)
+class timed_lock : public lc::rw_lock {
+public:
+  timed_lock() : write_count(0), write_nanos(0), longest_nanos(0) {}
+
+  count_type lock(lc::lock_auth_base *auth, bool read, bool block = true, bool test = false) {
+    count_type result = this->lc::rw_lock::lock(auth, read, block, test);
+    //NOTE: only one thread can hold the write lock, so this can't be overwritten
+    if (result >= 0 && !read && !test) held_since = clock_type::now();
+    return result;
+  }
+
+  count_type unlock(lc::lock_auth_base *auth, bool read, bool test = false) {
+    if (!read && !test) {
+      long nanos = std::chrono::duration_cast <std::chrono::nanoseconds> (
+        clock_type::now() - held_since).count();
+      ++write_count;
+      write_nanos += nanos;
+      long longest = longest_nanos;
+      while (nanos > longest && !longest_nanos.compare_exchange_weak(longest, nanos));
+    }
+    return this->lc::rw_lock::unlock(auth, read, test);
+  }
+
+  std::atomic <long> write_count, write_nanos, longest_nanos;
+
+private:
+  clock_type::time_point held_since;
+};
+
+typedef lc::basic_meta_lock <timed_lock> timed_meta_lock;
+
+
+typedef graph <int, int, timed_meta_lock> int_graph;
+typedef int_graph::shared_node            shared_node;
+
+static int    node_count      = 10000;
+static int    edges_per_node  = 4;
+static int    reader_count    = 2;
+static int    traverser_count = 2;
+static int    mutator_count   = 2;
+static double seconds         = 2;
+
+static std::atomic <bool> stop_threads(false);
+
+
+struct counts {
+  counts() : operations(0), rejected(0) {}
+
+  std::atomic <long> operations, rejected;
+};
+
+static counts reader_counts, traverser_counts, mutator_counts;
+
+
+//(the order of each node is fixed by its index, so re-inserted nodes keep it)
+static order_type node_order(const int_graph &the_graph, int index) {
+  return the_graph.get_order()? the_graph.get_order() + index + 1 : 0;
+}
+
+
+static void run_reader(int_graph *the_graph, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution <int> random_node(0, node_count - 1);
+  auth_type auth(the_graph->get_new_auth());
+  long total = 0;
+  while (!stop_threads) {
+    shared_node node = the_graph->find_node(random_node(generator), auth);
+    if (node) {
+      int_graph::protected_node::read_proxy read =
+        node->get_read_multi(*the_graph->show_master_lock(), auth);
+      if (read) total += read->obj;
+      else ++reader_counts.rejected;
+    }
+    ++reader_counts.operations;
+  }
+  (void) total;
+}
+
+
+static void run_traverser(int_graph *the_graph, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution <int> random_node(0, node_count - 1);
+  auth_type auth(the_graph->get_new_auth());
+  std::vector <shared_node> edges;
+  while (!stop_threads) {
+    shared_node current = the_graph->find_node(random_node(generator), auth);
+    for (int i = 0; current && i < WALK_STEPS && !stop_threads; i++) {
+      {
+        int_graph::protected_node::write_proxy write =
+          current->get_write_multi(*the_graph->show_master_lock(), auth);
+        if (!write) {
+          ++traverser_counts.rejected;
+          break;
+        }
+        edges.assign(write->out.begin(), write->out.end());
+      } //<-- the node is unlocked here, before moving to the next one
+      ++traverser_counts.operations;
+      if (edges.empty()) break;
+      current = edges[std::uniform_int_distribution <size_t> (0, edges.size() - 1)(generator)];
+    }
+  }
+}
+
+
+static void run_mutator(int_graph *the_graph, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution <int> random_node(0, node_count - 1), random_percent(0, 99);
+  auth_type auth(the_graph->get_new_auth());
+  while (!stop_threads) {
+    int operation = random_percent(generator), index = random_node(generator);
+    bool success = true;
+    if (operation < 80) {
+      shared_node left  = the_graph->find_node(index, auth);
+      shared_node right = the_graph->find_node(random_node(generator), auth);
+      if (left && right && left != right) {
+        success = (operation < 40)? the_graph->connect_nodes(left, right, auth) :
+                                    the_graph->disconnect_nodes(left, right, auth);
+      }
+    } else if (the_graph->find_node(index, auth)) {
+      success = the_graph->erase_node(index, auth);
+    } else {
+      success = the_graph->insert_node(index, auth, index, node_order(*the_graph, index));
+    }
+    if (!success) ++mutator_counts.rejected;
+    ++mutator_counts.operations;
+  }
+}
+
+
+static bool build_graph(int_graph &the_graph) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution <int> random_node(0, node_count - 1);
+  auth_type auth(the_graph.get_new_auth());
+  for (int i = 0; i < node_count; i++) {
+    if (!the_graph.insert_node(i, auth, i, node_order(the_graph, i))) return false;
+  }
+  for (int i = 0; i < node_count; i++) {
+    shared_node left = the_graph.find_node(i, auth);
+    for (int j = 0; j < edges_per_node; j++) {
+      shared_node right = the_graph.find_node(random_node(generator), auth);
+      if (!left || !right) return false;
+      if (left != right && !the_graph.connect_nodes(left, right, auth)) return false;
+    }
+  }
+  return true;
+}
+
+
+static void print_counts(const char *name, const counts &the_counts, double elapsed) {
+  long operations = the_counts.operations;
+  fprintf(stdout, "  %-10s %10.0f ops/s  rejected: %6.3f%%\n", name, operations / elapsed,
+    operations? 100.0 * the_counts.rejected / operations : 0.0);
+}
+
+
+static bool run_strategy(const char *name, order_type graph_order) {
+  int_graph the_graph(graph_order);
+  if (!build_graph(the_graph)) {
+    fprintf(stderr, "%s: could not build the graph\n", name);
+    return false;
+  }
+
+  reader_counts.operations    = reader_counts.rejected    = 0;
+  traverser_counts.operations = traverser_counts.rejected = 0;
+  mutator_counts.operations   = mutator_counts.rejected   = 0;
+  const timed_lock &meta = static_cast <timed_meta_lock&> (*the_graph.show_master_lock()).get_lock();
+  long initial_writes = meta.write_count, initial_nanos = meta.write_nanos;
+  stop_threads = false;
+
+  clock_type::time_point start = clock_type::now();
+  std::vector <std::thread> threads;
+  unsigned int seed = 1;
+  for (int i = 0; i < reader_count; i++) {
+    threads.push_back(std::thread(&run_reader, &the_graph, seed++));
+  }
+  for (int i = 0; i < traverser_count; i++) {
+    threads.push_back(std::thread(&run_traverser, &the_graph, seed++));
+  }
+  for (int i = 0; i < mutator_count; i++) {
+    threads.push_back(std::thread(&run_mutator, &the_graph, seed++));
+  }
+  std::this_thread::sleep_for(std::chrono::duration <double> (seconds));
+  stop_threads = true;
+  for (unsigned int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  std::chrono::duration <double> elapsed = clock_type::now() - start;
+
+  long writes = meta.write_count - initial_writes, nanos = meta.write_nanos - initial_nanos;
+  fprintf(stdout, "%s:\n", name);
+  print_counts("readers",    reader_counts,    elapsed.count());
+  print_counts("traversers", traverser_counts, elapsed.count());
+  print_counts("mutators",   mutator_counts,   elapsed.count());
+  fprintf(stdout, "  meta-lock  %10li writes  mean hold: %.1f us  max hold: %.1f us\n", writes,
+    writes? nanos / 1000.0 / writes : 0.0, meta.longest_nanos / 1000.0);
+  return true;
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) node_count      = atoi(argv[1]);
+  if (argc > 2) edges_per_node  = atoi(argv[2]);
+  if (argc > 3) reader_count    = atoi(argv[3]);
+  if (argc > 4) traverser_count = atoi(argv[4]);
+  if (argc > 5) mutator_count   = atoi(argv[5]);
+  if (argc > 6) seconds         = atof(argv[6]);
+  if (node_count < 2 || edges_per_node < 0 || reader_count < 0 || traverser_count < 0 ||
+      mutator_count < 0 || seconds <= 0) {
+    fprintf(stderr, "%s [nodes] [edges per node] [readers] [traversers] [mutators] [seconds]\n",
+      argv[0]);
+    return 1;
+  }
+
+  fprintf(stdout, "%i nodes, %i edges per node, %i readers, %i traversers, %i mutators\n",
+    node_count, edges_per_node, reader_count, traverser_count, mutator_count);
+
+  //(with an order of 0, the nodes are unordered and multiple locks use the meta-lock)
+  if (!run_strategy("meta_lock", 0))    return 1;
+  if (!run_strategy("ordered_lock", 1)) return 1;
+}
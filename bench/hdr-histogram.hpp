@@ -0,0 +1,86 @@
+/* This is a minimal high-dynamic-range histogram, used by the benchmarks in
+ * this directory to record latencies. Values are kept with a fixed number of
+ * significant bits (i.e., a fixed relative error) across the entire range of
+ * 'uint64_t', using a constant amount of memory. Recording is a single array
+ * increment, so each thread should record to its own histogram, which can then
+ * be merged.
+ */
+
+#ifndef hdr_histogram_hpp
+#define hdr_histogram_hpp
+
+#include <stdint.h>
+
+#include <vector>
+
+
+class hdr_histogram {
+public:
+  //NOTE: 'bits' significant bits means a relative error of at most 2^(1-bits)
+  explicit hdr_histogram(unsigned int new_bits = 10) :
+    bits(new_bits), sub_count(1ull << new_bits),
+    counts(sub_count + (64 - new_bits) * (sub_count / 2)), total(0), largest(0) {}
+
+  void record(uint64_t value) {
+    ++counts[this->get_index(value)];
+    ++total;
+    if (value > largest) largest = value;
+  }
+
+  void merge(const hdr_histogram &other) {
+    //(both histograms must have the same precision)
+    for (unsigned int i = 0; i < counts.size() && i < other.counts.size(); i++) {
+      counts[i] += other.counts[i];
+    }
+    total += other.total;
+    if (other.largest > largest) largest = other.largest;
+  }
+
+  uint64_t count() const {
+    return total;
+  }
+
+  uint64_t max() const {
+    return largest;
+  }
+
+  //(the largest value that's equivalent to the value at 'percent')
+  uint64_t percentile(double percent) const {
+    if (!total) return 0;
+    uint64_t target = (uint64_t) (percent / 100.0 * total + 0.5);
+    if (target < 1)     target = 1;
+    if (target > total) target = total;
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < counts.size(); i++) {
+      seen += counts[i];
+      if (seen >= target) {
+        uint64_t highest = this->get_highest(i);
+        return (highest < largest)? highest : largest;
+      }
+    }
+    return largest;
+  }
+
+private:
+  //values below 'sub_count' are exact; above that, each power of 2 is divided
+  //into 'sub_count / 2' buckets
+  unsigned int get_index(uint64_t value) const {
+    if (value < sub_count) return value;
+    unsigned int shift = 64 - __builtin_clzll(value) - bits;
+    return sub_count + (shift - 1) * (sub_count / 2) + ((value >> shift) - sub_count / 2);
+  }
+
+  uint64_t get_highest(unsigned int index) const {
+    if (index < sub_count) return index;
+    unsigned int shift  = (index - sub_count) / (sub_count / 2) + 1;
+    uint64_t     offset = (index - sub_count) % (sub_count / 2) + sub_count / 2;
+    return ((offset + 1) << shift) - 1;
+  }
+
+  unsigned int            bits;
+  uint64_t                sub_count;
+  std::vector <uint64_t> counts;
+  uint64_t                total, largest;
+};
+
+#endif //hdr_histogram_hpp
@@ -0,0 +1,6 @@
+/* This provides the non-template definitions for the compiled (default) build
+ * of "inline.cpp". It's compiled separately so that the definitions aren't
+ * visible to the compiler when it compiles the benchmark.
+ */
+
+#include "locking-container.inc"
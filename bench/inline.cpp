@@ -0,0 +1,88 @@
+/* This measures the cost of uncontended locking, to compare the compiled
+ * (default) build of "locking-container.inc" with the header-only build, where
+ * the lock and auth. functions can be inlined into callers. Run "bench.sh" to
+ * build and run both versions, or build them manually.
+ *
+ * Suggested compilation commands:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include inline.cpp inline-lib.cpp -o inline-compiled -lpthread
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include -DLC_HEADER_ONLY inline.cpp -o inline-header -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "locking-container.hpp"
+#ifdef LC_HEADER_ONLY
+#include "locking-container.inc"
+#endif
+
+#define ITERATIONS 10000000
+
+
+//NOTE: this keeps the compiler from removing the loops entirely
+static volatile long sink;
+
+
+template <class Lock>
+static double time_direct(bool read, bool use_auth) {
+  Lock lock;
+  lc::lock_auth <Lock> auth;
+  lc::lock_auth_base *auth_pointer = use_auth? &auth : NULL;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < ITERATIONS; i++) {
+    sink += lock.lock(auth_pointer, read);
+    sink += lock.unlock(auth_pointer, read);
+  }
+  std::chrono::duration <double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ITERATIONS;
+}
+
+
+template <class Lock>
+static double time_proxy(bool read, bool use_auth) {
+  typedef lc::locking_container <long, Lock> container;
+  container object;
+  lc::lock_auth_base::auth_type auth(container::new_auth());
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < ITERATIONS / 10; i++) {
+    if (read) {
+      typename container::read_proxy proxy =
+        use_auth? object.get_read_auth(auth) : object.get_read();
+      if (proxy) sink += *proxy;
+    } else {
+      typename container::write_proxy proxy =
+        use_auth? object.get_write_auth(auth) : object.get_write();
+      if (proxy) sink += ++*proxy;
+    }
+  }
+  std::chrono::duration <double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (ITERATIONS / 10);
+}
+
+
+template <class Lock>
+static void run_lock(const char *name, bool can_write) {
+  for (int read = can_write? 0 : 1; read < 2; read++) {
+    for (int use_auth = 0; use_auth < 2; use_auth++) {
+      fprintf(stdout, "%-14s %-5s %-7s direct: %7.2f ns/op  proxy: %7.2f ns/op\n", name,
+        read? "read" : "write", use_auth? "auth" : "no-auth",
+        time_direct <Lock> (read, use_auth), time_proxy <Lock> (read, use_auth));
+    }
+  }
+}
+
+
+int main() {
+#ifdef LC_HEADER_ONLY
+  fprintf(stdout, "mode: header-only\n");
+#else
+  fprintf(stdout, "mode: compiled\n");
+#endif
+  run_lock <lc::rw_lock>   ("rw_lock",   true);
+  run_lock <lc::r_lock>    ("r_lock",    false);
+  run_lock <lc::w_lock>    ("w_lock",    true);
+  run_lock <lc::dumb_lock> ("dumb_lock", true);
+  return sink == 0x12345? EXIT_FAILURE : EXIT_SUCCESS;
+}
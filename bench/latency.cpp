@@ -0,0 +1,134 @@
+/* This is an open-loop load generator for measuring the latency of lock
+ * requests. Each thread issues 'get_read' and 'get_write' requests on a shared
+ * set of containers according to a schedule (Poisson or fixed-rate arrivals),
+ * regardless of how long previous requests took. Latency is measured from the
+ * time each request was scheduled to start, rather than from when it actually
+ * started, so that time spent waiting behind slow requests is counted (i.e., no
+ * coordinated omission). Latencies are recorded in HDR histograms, and tail
+ * percentiles are reported for each lock type.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include latency.cpp -o latency -lpthread
+ *
+ * Usage: ./latency [requests/s] [seconds] [threads] [poisson|fixed] [write %]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#include "hdr-histogram.hpp"
+
+#define CONTAINERS 4
+//(approximate work done while holding each lock)
+#define HOLD_LOOPS 200
+
+
+typedef std::chrono::steady_clock clock_type;
+
+static double       request_rate  = 100000;
+static double       seconds       = 2;
+static unsigned int thread_count  = 4;
+static bool         poisson       = true;
+static int          write_percent = 20;
+
+static volatile long sink;
+
+
+template <class Lock>
+static void run_thread(lc::locking_container <long, Lock> *containers, unsigned int seed,
+  clock_type::time_point start, hdr_histogram *latency) {
+  typedef lc::locking_container <long, Lock> container;
+  std::mt19937 generator(seed);
+  //(each thread generates its share of the requests)
+  double mean_interval = thread_count / request_rate;
+  std::exponential_distribution <double> random_interval(1.0 / mean_interval);
+  std::uniform_int_distribution <int> random_percent(0, 99), random_container(0, CONTAINERS - 1);
+
+  clock_type::time_point end = start + std::chrono::duration_cast <clock_type::duration> (
+    std::chrono::duration <double> (seconds));
+  //(offset the fixed-rate threads so that they don't all start at once)
+  double offset = poisson? random_interval(generator) : mean_interval * seed / thread_count;
+  clock_type::time_point intended = start + std::chrono::duration_cast <clock_type::duration> (
+    std::chrono::duration <double> (offset));
+
+  while (intended < end) {
+    //NOTE: if the thread is behind schedule, the next request starts immediately
+    std::this_thread::sleep_until(intended);
+
+    container &object = containers[random_container(generator)];
+    if (random_percent(generator) < write_percent) {
+      typename container::write_proxy write = object.get_write();
+      if (!write) abort();
+      for (int i = 0; i < HOLD_LOOPS; i++) sink += ++*write;
+    } else {
+      typename container::read_proxy read = object.get_read();
+      if (!read) abort();
+      for (int i = 0; i < HOLD_LOOPS; i++) sink += *read;
+    }
+
+    std::chrono::duration <double, std::nano> elapsed = clock_type::now() - intended;
+    latency->record((uint64_t) elapsed.count());
+
+    double interval = poisson? random_interval(generator) : mean_interval;
+    intended += std::chrono::duration_cast <clock_type::duration> (
+      std::chrono::duration <double> (interval));
+  }
+}
+
+
+template <class Lock>
+static void run_lock(const char *name) {
+  lc::locking_container <long, Lock> containers[CONTAINERS];
+  std::vector <hdr_histogram> latencies(thread_count);
+
+  clock_type::time_point start = clock_type::now() + std::chrono::milliseconds(10);
+  std::vector <std::thread> threads;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads.push_back(std::thread(&run_thread <Lock>, containers, i, start, &latencies[i]));
+  }
+
+  hdr_histogram total;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads[i].join();
+    total.merge(latencies[i]);
+  }
+
+  //(reported in microseconds)
+  fprintf(stdout, "%-14s %9llu requests  p50: %9.1f  p90: %9.1f  p99: %9.1f  "
+    "p99.9: %9.1f  p99.99: %9.1f  max: %9.1f\n", name, (unsigned long long) total.count(),
+    total.percentile(50)    / 1000.0, total.percentile(90)    / 1000.0,
+    total.percentile(99)    / 1000.0, total.percentile(99.9)  / 1000.0,
+    total.percentile(99.99) / 1000.0, total.max()             / 1000.0);
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) request_rate  = atof(argv[1]);
+  if (argc > 2) seconds       = atof(argv[2]);
+  if (argc > 3) thread_count  = atoi(argv[3]);
+  if (argc > 4) poisson       = strcmp(argv[4], "fixed") != 0;
+  if (argc > 5) write_percent = atoi(argv[5]);
+  if (request_rate <= 0 || seconds <= 0 || thread_count < 1) {
+    fprintf(stderr, "%s [requests/s] [seconds] [threads] [poisson|fixed] [write %%]\n", argv[0]);
+    return 1;
+  }
+
+  fprintf(stdout, "%.0f requests/s (%s), %u threads, %i%% writes; latency in us\n",
+    request_rate, poisson? "poisson" : "fixed", thread_count, write_percent);
+
+  run_lock <lc::rw_lock>       ("rw_lock");
+  run_lock <lc::w_lock>        ("w_lock");
+  run_lock <lc::dumb_lock>     ("dumb_lock");
+  run_lock <lc::adaptive_lock> ("adaptive_lock");
+  run_lock <lc::priority_lock> ("priority_lock");
+}
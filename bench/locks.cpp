@@ -0,0 +1,138 @@
+/* This measures contended locking for each combination of lock type and
+ * authorization, along with hardware and software counters per operation (see
+ * "perf-counters.hpp"). Each thread repeatedly locks one of a few shared
+ * containers, mostly for reading, and does a small amount of work while holding
+ * the lock.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include locks.cpp -o locks -lpthread
+ *
+ * Usage: ./locks [threads] [operations per thread]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#include "perf-counters.hpp"
+
+#define CONTAINERS   4
+#define READ_PERCENT 80
+
+
+static unsigned int thread_count = 4;
+static long         operations   = 200000;
+
+
+template <class Lock>
+struct test_containers {
+  typedef lc::locking_container <long, Lock> container;
+
+  //(ordered locks need an order; the others ignore the argument)
+  test_containers() {
+    for (int i = 0; i < CONTAINERS; i++) {
+      objects.push_back(std::unique_ptr <container> (test_containers::create(i + 1, (Lock*) NULL)));
+    }
+  }
+
+  template <class Base>
+  static container *create(int order, lc::ordered_lock <Base>*) {
+    return new container(0, order);
+  }
+
+  static container *create(int /*order*/, void*) {
+    return new container(0);
+  }
+
+  std::vector <std::unique_ptr <container> > objects;
+};
+
+
+template <class Lock>
+static void run_thread(test_containers <Lock> *containers, bool use_auth, unsigned int seed) {
+  typedef typename test_containers <Lock> ::container container;
+  lc::lock_auth_base::auth_type auth(container::new_auth());
+  for (long i = 0; i < operations; i++) {
+    container &object = *containers->objects[rand_r(&seed) % CONTAINERS];
+    if ((int) (rand_r(&seed) % 100) < READ_PERCENT) {
+      typename container::read_proxy read =
+        use_auth? object.get_read_auth(auth) : object.get_read();
+      if (!read) abort();
+      for (int j = 0; j < 16; j++) seed += *read;
+    } else {
+      typename container::write_proxy write =
+        use_auth? object.get_write_auth(auth) : object.get_write();
+      if (!write) abort();
+      for (int j = 0; j < 16; j++) ++*write;
+    }
+  }
+}
+
+
+template <class Lock>
+static void run_lock(const char *name, bool use_auth) {
+  test_containers <Lock> containers;
+  perf_counters counters;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  counters.start();
+  //NOTE: the threads must be created after the counters in order to inherit them
+  std::vector <std::thread> threads;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads.push_back(std::thread(&run_thread <Lock>, &containers, use_auth, i));
+  }
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads[i].join();
+  }
+  counters.stop();
+  std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double total = (double) operations * thread_count;
+  fprintf(stdout, "%-22s %-7s %10.0f ops/s", name, use_auth? "auth" : "no-auth",
+    total / elapsed.count());
+  for (unsigned int i = 0; i < counters.size(); i++) {
+    if (counters.value(i) < 0) continue;
+    fprintf(stdout, "  %s/op: %.2f", counters.name(i).c_str(), counters.value(i) / total);
+  }
+  fprintf(stdout, "\n");
+}
+
+
+template <class Lock>
+static void run_both(const char *name) {
+  run_lock <Lock> (name, false);
+  run_lock <Lock> (name, true);
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) thread_count = atoi(argv[1]);
+  if (argc > 2) operations   = atol(argv[2]);
+  if (thread_count < 1 || operations < 1) {
+    fprintf(stderr, "%s [threads] [operations per thread]\n", argv[0]);
+    return 1;
+  }
+
+  {
+    perf_counters counters;
+    if (!counters.size()) {
+      fprintf(stderr, "(no performance counters are available; only reporting throughput)\n");
+    }
+  }
+
+  run_both <lc::rw_lock>       ("rw_lock");
+  run_both <lc::w_lock>        ("w_lock");
+  run_both <lc::dumb_lock>     ("dumb_lock");
+  run_both <lc::adaptive_lock> ("adaptive_lock");
+  run_both <lc::priority_lock> ("priority_lock");
+  //(ordered locks can't be used without an auth. object)
+  run_lock <lc::ordered_lock <lc::rw_lock> > ("ordered_lock<rw_lock>", true);
+  run_lock <lc::ordered_lock <lc::w_lock> >  ("ordered_lock<w_lock>",  true);
+}
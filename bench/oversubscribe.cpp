@@ -0,0 +1,191 @@
+/* This measures how each lock type behaves when there are more runnable
+ * threads than CPUs, i.e., when lock holders can be descheduled in the middle
+ * of a critical section. Each lock type is run with 1x, 2x, 4x, and 8x as many
+ * threads as CPUs, all repeatedly taking a write lock on one container. The
+ * threads can optionally be pinned to a subset of the CPUs. For each run, this
+ * reports:
+ *
+ *   - Throughput, and throughput relative to the 1x run (i.e., collapse).
+ *
+ *   - Lock-holder stalls: critical sections that took much longer than
+ *     expected, which almost always means that the holder was preempted.
+ *
+ *   - Wakeup latency: for threads that had to wait, the time from the previous
+ *     holder's release to the waiting thread's acquisition.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include oversubscribe.cpp -o oversubscribe -lpthread
+ *
+ * Usage: ./oversubscribe [seconds per run] [CPU list, e.g., 0-3 or 0,2]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#include "hdr-histogram.hpp"
+
+//(work done while holding the lock)
+#define HOLD_LOOPS  100
+//(critical sections longer than this are counted as stalls)
+#define STALL_NANOS 50000
+
+
+typedef std::chrono::steady_clock clock_type;
+
+static double    seconds = 1;
+static cpu_set_t cpus;
+static bool      pin_threads = false;
+
+static std::atomic <bool> stop_threads(false);
+
+
+static long now_nanos() {
+  return std::chrono::duration_cast <std::chrono::nanoseconds> (
+    clock_type::now().time_since_epoch()).count();
+}
+
+
+struct thread_result {
+  thread_result() : operations(0), stalls(0), stall_nanos(0) {}
+
+  long          operations, stalls, stall_nanos;
+  hdr_histogram wakeup;
+};
+
+
+struct shared_state {
+  shared_state() : last_release(0) {}
+
+  //(only written while holding the lock)
+  std::atomic <long> last_release;
+};
+
+
+template <class Lock>
+static void run_thread(lc::locking_container <long, Lock> *object, shared_state *state,
+  thread_result *result) {
+  typedef lc::locking_container <long, Lock> container;
+  if (pin_threads) pthread_setaffinity_np(pthread_self(), sizeof cpus, &cpus);
+  while (!stop_threads) {
+    //(try first, so that we know whether or not this thread had to wait)
+    typename container::write_proxy write = object->get_write(false);
+    bool waited = !write;
+    if (waited) write = object->get_write();
+    if (!write) abort();
+
+    long start = now_nanos();
+    if (waited) result->wakeup.record(start - state->last_release.load());
+    for (int i = 0; i < HOLD_LOOPS; i++) ++*write;
+    long end = now_nanos();
+
+    if (end - start > STALL_NANOS) {
+      ++result->stalls;
+      result->stall_nanos += end - start;
+    }
+    state->last_release = end;
+    ++result->operations;
+  } //<-- the lock is released here, right after 'last_release' is set
+}
+
+
+template <class Lock>
+static double run_once(unsigned int thread_count, double baseline) {
+  lc::locking_container <long, Lock> object;
+  shared_state state;
+  std::vector <thread_result> results(thread_count);
+  stop_threads = false;
+
+  clock_type::time_point start = clock_type::now();
+  std::vector <std::thread> threads;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads.push_back(std::thread(&run_thread <Lock>, &object, &state, &results[i]));
+  }
+  std::this_thread::sleep_for(std::chrono::duration <double> (seconds));
+  stop_threads = true;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads[i].join();
+  }
+  std::chrono::duration <double> elapsed = clock_type::now() - start;
+
+  thread_result total;
+  for (unsigned int i = 0; i < thread_count; i++) {
+    total.operations  += results[i].operations;
+    total.stalls      += results[i].stalls;
+    total.stall_nanos += results[i].stall_nanos;
+    total.wakeup.merge(results[i].wakeup);
+  }
+
+  double throughput = total.operations / elapsed.count();
+  fprintf(stdout, "  %4u threads %10.0f ops/s (%5.2fx)  stalls/1k ops: %7.3f  "
+    "stalled: %5.1f%%  wakeup p50: %8.1f us  p99: %8.1f us\n", thread_count, throughput,
+    baseline? throughput / baseline : 1.0,
+    total.operations? 1000.0 * total.stalls / total.operations : 0.0,
+    100.0 * total.stall_nanos / 1e9 / elapsed.count(),
+    total.wakeup.percentile(50) / 1000.0, total.wakeup.percentile(99) / 1000.0);
+  return throughput;
+}
+
+
+template <class Lock>
+static void run_lock(const char *name, unsigned int cpu_count) {
+  fprintf(stdout, "%s:\n", name);
+  double baseline = 0;
+  for (unsigned int factor = 1; factor <= 8; factor *= 2) {
+    double throughput = run_once <Lock> (cpu_count * factor, baseline);
+    if (factor == 1) baseline = throughput;
+  }
+}
+
+
+//(parses a list such as "0-3,6")
+static bool parse_cpus(const char *list) {
+  CPU_ZERO(&cpus);
+  while (*list) {
+    char *end = NULL;
+    long first = strtol(list, &end, 10), last = first;
+    if (end == list || first < 0) return false;
+    if (*end == '-') {
+      list = end + 1;
+      last = strtol(list, &end, 10);
+      if (end == list || last < first) return false;
+    }
+    for (long i = first; i <= last && i < CPU_SETSIZE; i++) CPU_SET(i, &cpus);
+    if (*end == ',') ++end;
+    else if (*end) return false;
+    list = end;
+  }
+  return CPU_COUNT(&cpus) > 0;
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) seconds = atof(argv[1]);
+  if (argc > 2) pin_threads = true;
+  if (seconds <= 0 || (pin_threads && !parse_cpus(argv[2]))) {
+    fprintf(stderr, "%s [seconds per run] [CPU list, e.g., 0-3 or 0,2]\n", argv[0]);
+    return 1;
+  }
+
+  unsigned int cpu_count = pin_threads? CPU_COUNT(&cpus) : std::thread::hardware_concurrency();
+  if (cpu_count < 1) cpu_count = 1;
+  fprintf(stdout, "%u CPUs%s; stalls are critical sections longer than %i us\n", cpu_count,
+    pin_threads? " (pinned)" : "", STALL_NANOS / 1000);
+
+  run_lock <lc::rw_lock>       ("rw_lock",       cpu_count);
+  run_lock <lc::w_lock>        ("w_lock",        cpu_count);
+  run_lock <lc::dumb_lock>     ("dumb_lock",     cpu_count);
+  run_lock <lc::adaptive_lock> ("adaptive_lock", cpu_count);
+  run_lock <lc::priority_lock> ("priority_lock", cpu_count);
+}
@@ -0,0 +1,113 @@
+/* This is a minimal wrapper for Linux hardware and software performance
+ * counters (see 'man perf_event_open'), used by the benchmarks in this
+ * directory. Counters are opened for the calling thread and inherited by any
+ * threads it creates afterward; the values include all of those threads once
+ * they've been joined. Counters that can't be opened (e.g., in a VM, or due to
+ * /proc/sys/kernel/perf_event_paranoid) are skipped.
+ *
+ * Cache-line transfers between cores (HITM) don't have a generic event, so the
+ * raw event code must be given in LC_PERF_HITM, e.g., for some Intel CPUs:
+ *   LC_PERF_HITM=0x10d2 ./locks
+ */
+
+#ifndef perf_counters_hpp
+#define perf_counters_hpp
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <string>
+#include <vector>
+
+
+class perf_counters {
+public:
+  perf_counters() {
+    this->add("cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    this->add("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    this->add("llc-misses",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    this->add("ctx-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+    const char *hitm = getenv("LC_PERF_HITM");
+    if (hitm && *hitm) this->add("hitm", PERF_TYPE_RAW, strtoull(hitm, NULL, 0));
+  }
+
+private:
+  perf_counters(const perf_counters&);
+  perf_counters &operator = (const perf_counters&);
+
+public:
+  void start() {
+    for (unsigned int i = 0; i < counters.size(); i++) {
+      ioctl(counters[i].fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  //NOTE: call this after joining all of the threads being measured
+  void stop() {
+    for (unsigned int i = 0; i < counters.size(); i++) {
+      ioctl(counters[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t values[3] = { 0, 0, 0 };
+      if (read(counters[i].fd, values, sizeof values) != sizeof values || !values[2]) {
+        counters[i].value = -1;
+      } else {
+        //(scale the count if the counter was multiplexed with others)
+        counters[i].value = (double) values[0] * values[1] / values[2];
+      }
+    }
+  }
+
+  unsigned int size() const {
+    return counters.size();
+  }
+
+  const std::string &name(unsigned int i) const {
+    return counters[i].name;
+  }
+
+  //(negative if the value couldn't be read)
+  double value(unsigned int i) const {
+    return counters[i].value;
+  }
+
+  ~perf_counters() {
+    for (unsigned int i = 0; i < counters.size(); i++) {
+      close(counters[i].fd);
+    }
+  }
+
+private:
+  struct counter {
+    std::string name;
+    int         fd;
+    double      value;
+  };
+
+  void add(const char *name, uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size           = sizeof attr;
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    //NOTE: context switches happen in the kernel, so they need to be counted there
+    if (type == PERF_TYPE_SOFTWARE) attr.exclude_kernel = 0;
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) return;
+    counter new_counter = { name, fd, 0 };
+    counters.push_back(new_counter);
+  }
+
+  std::vector <counter> counters;
+};
+
+#endif //perf_counters_hpp
@@ -0,0 +1,73 @@
+/* This is an example of 'lc::batch_executor'. Each operation in the batch
+ * updates one account using the value of another account, which means that
+ * the result depends on the order of the operations. The batch is run in
+ * parallel, and then the result is compared to running the same operations in
+ * order on a single thread.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include batch.cpp -o batch -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "batch-executor.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define ACCOUNTS   64
+#define OPERATIONS 20000
+#define WORKERS    4
+
+
+typedef lc::locking_container <long, lc::parking_lock <lc::rw_lock> > account;
+
+static account accounts[ACCOUNTS];
+static long    expected[ACCOUNTS];
+
+
+static long update(long target, long source) {
+  return (target * 31 + source) % 1000003;
+}
+
+static bool transfer(lc::task_scheduler::context &context, int target, int source) {
+  //NOTE: these can't fail due to other operations in the batch
+  account::write_proxy write = context.get_write(accounts[target]);
+  if (!write) return false;
+  account::read_proxy read = context.get_read(accounts[source]);
+  if (!read) return false;
+  *write = update(*write, *read);
+  return true;
+}
+
+
+int main() {
+  lc::task_scheduler scheduler(WORKERS);
+  lc::batch_executor batch(scheduler);
+
+  for (int i = 0; i < ACCOUNTS; i++) {
+    *accounts[i].get_write() = expected[i] = i;
+  }
+
+  srand(1);
+  for (int i = 0; i < OPERATIONS; i++) {
+    int target = rand() % ACCOUNTS, source = rand() % ACCOUNTS;
+    if (source == target) source = (source + 1) % ACCOUNTS;
+    batch.add(lc::batch_executor::operation(
+        std::bind(&transfer, std::placeholders::_1, target, source))
+      .writes(accounts[target])
+      .reads(accounts[source]));
+    //(the same operations, in order)
+    expected[target] = update(expected[target], expected[source]);
+  }
+
+  batch.run();
+
+  for (int i = 0; i < ACCOUNTS; i++) {
+    account::read_proxy read = accounts[i].get_read();
+    assert(read && *read == expected[i]);
+  }
+
+  fprintf(stdout, "%i operations matched sequential execution\n", OPERATIONS);
+}
@@ -0,0 +1,71 @@
+/* This is an example of 'lc::coalescing_container'. Several threads publish
+ * quotes for a price, and only the latest quote matters. Publishing never
+ * waits for the lock; quotes that are replaced before they're installed are
+ * simply discarded. A reader checks that it never sees a thread's quotes go
+ * backward, and the final price must be the last quote published.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include coalescing.cpp -o coalescing -lpthread
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <thread>
+#include <vector>
+
+#include "coalescing-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define PUBLISHERS 4
+#define QUOTES     100000
+#define READS      10000
+
+
+struct quote {
+  int  publisher;
+  long sequence;
+};
+
+typedef lc::coalescing_container <quote> price;
+
+static price current_price(quote{ -1, -1 });
+
+
+static void publisher(int number) {
+  for (long i = 0; i < QUOTES; i++) {
+    current_price.publish(quote{ number, i });
+  }
+}
+
+static void reader() {
+  long latest[PUBLISHERS];
+  for (int i = 0; i < PUBLISHERS; i++) latest[i] = -1;
+
+  for (int i = 0; i < READS; i++) {
+    price::read_proxy read = current_price.get_read();
+    assert(read);
+    if (read->publisher < 0) continue;
+    assert(read->sequence >= latest[read->publisher]);
+    latest[read->publisher] = read->sequence;
+  }
+}
+
+
+int main() {
+  std::vector <std::thread> threads;
+  for (int i = 0; i < PUBLISHERS; i++) {
+    threads.push_back(std::thread(&publisher, i));
+  }
+  threads.push_back(std::thread(&reader));
+  for (unsigned int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  price::read_proxy read = current_price.get_read();
+  assert(read && read->sequence == QUOTES - 1);
+
+  fprintf(stdout, "published: %i, discarded: %lu\n", PUBLISHERS * QUOTES,
+    current_price.get_superseded());
+}
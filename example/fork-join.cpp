@@ -0,0 +1,65 @@
+/* This is an example of 'lc::parallel_read'. A single read lock is obtained on
+ * a container holding a large vector, and then the vector is summed in parallel
+ * by helper threads that don't lock anything themselves.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O3 -I../include fork-join.cpp -o fork-join -lpthread
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <vector>
+
+#include "locking-container.hpp"
+#include "fork-join.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define SIZE    (1 << 22)
+#define HELPERS 3
+
+
+typedef lc::locking_container <std::vector <float> > protected_vector;
+
+//(a plain loop over a contiguous range, which the compiler can vectorize)
+static float sum_range(const float *values, size_t count) {
+  float sum = 0;
+  for (size_t i = 0; i < count; i++) {
+    sum += values[i];
+  }
+  return sum;
+}
+
+
+int main() {
+  protected_vector data;
+
+  {
+    protected_vector::write_proxy write = data.get_write();
+    assert(write);
+    write->resize(SIZE);
+    for (int i = 0; i < SIZE; i++) {
+      (*write)[i] = i % 8;
+    }
+  }
+
+  protected_vector::read_proxy read = data.get_read();
+  assert(read);
+
+  //one partial sum per part, combined in order afterward
+  std::vector <double> partial(HELPERS + 1, 0.0);
+  unsigned int parts = lc::parallel_read(read, read->size(), HELPERS,
+    [&partial](const std::vector <float> &values, size_t begin, size_t end, unsigned int part) {
+      partial[part] = sum_range(&values[0] + begin, end - begin);
+    });
+
+  double total = 0;
+  for (unsigned int i = 0; i < parts; i++) {
+    total += partial[i];
+  }
+
+  //(every block of 8 elements sums to 28)
+  assert(total == 28.0 * (SIZE / 8));
+  fprintf(stdout, "parts: %u, total: %.0f\n", parts, total);
+}
@@ -64,25 +64,15 @@
  *     lock two specific nodes (e.g., to add or delete an edge), it can lock the
  *     node with the lower order first, preventing potential deadlocks.
  *
- * Things I still need to implement here:
- *
- *   - Add some threads that move around the graph and perform various
- *     operations. The main thread already demonstrates that the design pattern
- *     works when no other threads hold locks on nodes; this example needs to be
- *     extended to demonstrate that it works when arbitrary nodes are locked.
- *     (It almost certainly won't deadlock; however, it still needs to be
- *     designed to succeed in the face of rejected locks.)
- *
- *   - I need to come up with a better design pattern for moving from one node
- *     to another without a spinlock. One option is to: 1) obtain a write lock
- *     on the current node; 2) copy its list of edges; 3) unlock the current
- *     node; 4) preview/select a destination node from the copied list. This
- *     obviates the need for holding multiple locks at once. Note that even if
- *     an edge is deleted during step 4, the destination node will always still
- *     exist. The trade-off is accepting that the graph might be modified during
- *     the operation. (Another perspective is that it makes no difference
- *     whether or not the edge is removed before or after the move, as long as
- *     the move succeeds in both cases.)
+ * The data structure itself is in "graph.hpp". "../bench/graph.cpp" uses it
+ * with threads that move around the graph and modify it while arbitrary nodes
+ * are locked, counting and skipping operations whose locks are rejected. Those
+ * threads move from one node to another by 1) obtaining a write lock on the
+ * current node; 2) copying its list of edges; 3) unlocking the current node; 4)
+ * selecting a destination node from the copied list. This obviates the need for
+ * holding multiple locks at once. Note that even if an edge is deleted during
+ * step 4, the destination node will always still exist. The trade-off is
+ * accepting that the graph might be modified during the operation.
  *
  * Suggested compilation command:
  *   c++ -Wall -pedantic -std=c++11 -O2 -I../include graph-multi.cpp -o graph-multi -lpthread
@@ -100,280 +90,12 @@
 #include <stdio.h>
 
 #include "locking-container.hpp"
+#include "deferred-handle.hpp"
+#include "graph.hpp"
 //(necessary for non-template source)
 #include "locking-container.inc"
 
 
-typedef lc::lock_auth_base::auth_type  auth_type;
-typedef lc::lock_auth_base::order_type order_type;
-typedef lc::shared_meta_lock           shared_meta_lock;
-
-
-template <class Type>
-struct graph_node {
-  typedef Type stored_type;
-  typedef lc::locking_container_base <graph_node> protected_node;
-  typedef std::shared_ptr <protected_node>        shared_node;
-  typedef std::unordered_set <shared_node>        connected_nodes;
-
-  inline graph_node(const stored_type &value) : obj(value) {}
-
-  inline graph_node(stored_type &&value = stored_type()) : obj(std::move(value)) {}
-
-  inline graph_node(graph_node &&other) : out(std::move(other.out)),
-    in(std::move(other.in)), obj(std::move(other.obj)) {}
-
-private:
-  graph_node(const graph_node&);
-  graph_node &operator = (const graph_node&);
-
-public:
-  static inline bool connect_nodes(shared_node left, shared_node right,
-    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
-    bool try_multi = true) {
-    return change_connection_common(&insert_edge, left, right, auth, master_lock, try_multi);
-  }
-
-  static inline bool disconnect_nodes(shared_node left, shared_node right,
-    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
-    bool try_multi = true) {
-    return change_connection_common(&erase_edge, left, right, auth, master_lock, try_multi);
-  }
-
-  //NOTE: this might never get called if there's a circular reference!
-  virtual inline ~graph_node() {}
-
-  connected_nodes out, in;
-  stored_type     obj;
-
-protected:
-  static void insert_edge(connected_nodes &left, const shared_node &right) {
-    left.insert(right);
-  }
-
-  static void erase_edge(connected_nodes &left, const shared_node &right) {
-    left.erase(right);
-  }
-
-  template <class Func>
-  static bool change_connection_common(Func func, shared_node left, shared_node right,
-    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
-    bool try_multi = true) {
-    assert(left.get() && right.get());
-    lc::meta_lock::write_proxy multi;
-    if (try_multi && master_lock && !(multi = master_lock->get_write_auth(auth))) return false;
-
-    typename protected_node::write_proxy write_l, write_r;
-    if (!lc::get_two_locks(*left, *right, write_l, write_r, true, auth, master_lock.get())) return false;
-    multi.clear();
-
-    (*func)(write_l->out, right);
-    (*func)(write_r->in,  left);
-
-    return true;
-  }
-};
-
-
-template <class Type>
-struct graph_head {
-  typedef graph_node <Type>             node;
-  typedef typename node::stored_type    stored_type;
-  typedef typename node::protected_node protected_node;
-  typedef typename node::shared_node    shared_node;
-
-  virtual shared_node get_graph_head(auth_type auth) = 0;
-
-  virtual typename lc::meta_lock_base::write_proxy get_master_lock(auth_type auth)   = 0;
-  virtual typename lc::meta_lock_base::read_proxy  block_master_lock(auth_type auth) = 0;
-  virtual shared_meta_lock show_master_lock() = 0;
-
-  virtual inline ~graph_head() {}
-};
-
-
-template <class Index, class Type>
-class graph : public graph_head <Type> {
-public:
-  typedef graph_head <Type> base;
-  using typename base::node;
-  using typename base::stored_type;
-  using typename base::protected_node;
-  using typename base::shared_node;
-
-  typedef Index                                        index_type;
-  typedef std::unordered_map <index_type, shared_node> node_map;
-  typedef typename node_map::iterator                  iterator;
-
-  typedef lc::ordered_lock <lc::rw_lock>              lock_type;
-  typedef lc::locking_container <node_map, lock_type> protected_node_map;
-  typedef lc::locking_container <node, lock_type>     locking_node;
-
-  graph(order_type o) : master_lock(new lc::meta_lock), all_nodes(node_map(), o) {}
-
-private:
-  graph(const graph&);
-  graph &operator = (const graph&);
-
-public:
-    inline auth_type get_new_auth() const {
-      return all_nodes.get_new_auth();
-    }
-
-  shared_node get_graph_head(auth_type auth) {
-    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
-    if (!write) return shared_node();
-    return write->size()? write->begin()->second : shared_node();
-  }
-
-  typename lc::meta_lock_base::write_proxy get_master_lock(auth_type auth) {
-    return master_lock? master_lock->get_write_auth(auth) : lc::meta_lock_base::write_proxy();
-  }
-
-  typename lc::meta_lock_base::read_proxy block_master_lock(auth_type auth) {
-    return master_lock? master_lock->get_read_auth(auth) : lc::meta_lock_base::read_proxy();
-  }
-
-  shared_meta_lock show_master_lock() {
-    assert(master_lock.get());
-    return master_lock;
-  }
-
-  inline order_type get_order() const {
-    return all_nodes.get_order();
-  }
-
-  virtual bool connect_nodes(shared_node left, shared_node right, auth_type auth) {
-    //NOTE: this doesn't use 'find_node' so that error returns only pertain to
-    //failed lock operations
-    return node::connect_nodes(left, right, auth, master_lock, !this->get_order());
-  }
-
-  virtual bool disconnect_nodes(shared_node left, shared_node right, auth_type auth) {
-    //NOTE: this doesn't use 'find_node' so that error returns only pertain to
-    //failed lock operations
-    return node::disconnect_nodes(left, right, auth, master_lock, !this->get_order());
-  }
-
-  virtual shared_node find_node(const index_type &index, auth_type auth) {
-    assert(master_lock.get());
-    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
-    if (!write) return shared_node();
-    typename node_map::iterator found = write->find(index);
-    return (found == write->end())? shared_node() : found->second;
-  }
-
-  template <class ... Args>
-  inline bool insert_node(const index_type &index, auth_type auth, Args ... args) {
-    shared_node value(new locking_node(args...));
-    assert(value.get());
-    //NOTE: added nodes must have higher order than the node map itself
-    assert(!all_nodes.get_order() || value->get_order() > all_nodes.get_order());
-    return this->change_node(index, auth, &replace_node, value);
-  }
-
-  virtual bool erase_node(const index_type &index, auth_type auth) {
-    return this->change_node(index, auth, &remove_node);
-  }
-
-  template <class Func, class ... Args>
-  inline bool iterate_nodes_write(auth_type auth, Func func, Args ... args) {
-    return this->iterate_nodes(&protected_node::get_write_auth, auth, func, args...);
-  }
-
-  template <class Func, class ... Args>
-  inline bool iterate_nodes_read(auth_type auth, Func func, Args ... args) {
-    return this->iterate_nodes(&protected_node::get_read_auth, auth, func, args...);
-  }
-
-  virtual ~graph() {
-    auth_type auth(this->get_new_auth());
-    typename protected_node_map::write_proxy write = all_nodes.get_write_auth(auth, false);
-    assert(write);
-    for (typename node_map::iterator current = write->begin(), end = write->end();
-         current != end; ++current) {
-      assert(current->second.get());
-      //NOTE: if it's already locked, that's a serious problem here
-      //NOTE: auth. is only used to appease ordered locks
-      typename node::protected_node::write_proxy this_node = current->second->get_write_auth(auth, false);
-      assert(this_node);
-      //NOTE: doing this prevents a circular reference memory leak
-      this_node->out.clear();
-      this_node->in.clear();
-    }
-  }
-
-protected:
-  static void replace_node(node_map &the_nodes, const index_type &index, shared_node value) {
-    the_nodes[index] = value;
-  }
-
-  static void remove_node(node_map &the_nodes, const index_type &index) {
-    the_nodes.erase(index);
-  }
-
-  template <class Member>
-  bool remove_edges(shared_node value, Member remove_left, Member remove_right, auth_type auth) {
-    assert(master_lock.get());
-    typename node::protected_node::write_proxy left = value->get_write_multi(*master_lock, auth);
-    if (!left) return false;
-    for (typename node::connected_nodes::iterator
-         current = (left->*remove_left).begin(), end = (left->*remove_left).end();
-         current != end; ++current) {
-      assert(current->get());
-      typename node::protected_node::write_proxy right = (*current)->get_write_multi(*master_lock, auth);
-      if (!right) return false;
-      (right->*remove_right).erase(value);
-    }
-    return true;
-  }
-
-  template <class Func, class ... Args>
-  bool change_node(const index_type &index, auth_type auth, Func func, Args ... args) {
-    assert(master_lock.get());
-    shared_node old_node = this->find_node(index, auth);
-    //NOTE: this is in the outer scope so the lock is continuous
-    lc::meta_lock::write_proxy protect_write;
-    if (old_node) {
-      //(boot off all other locks)
-      protect_write = this->get_master_lock(auth);
-      if (!protect_write) return false;
-      //NOTE: these should never fail if 'master_lock' is used properly
-      if (!this->remove_edges(old_node, &node::out, &node::in, auth)) return false;
-      if (!this->remove_edges(old_node, &node::in, &node::out, auth)) return false;
-    }
-    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
-    if (!write) return false;
-    //NOTE: if this results in destruction of the old node, it shouldn't have
-    //any locks on it that will cause problems
-    (*func)(*write, index, args...);
-    return true;
-  }
-
-  template <class Func, class Proxy, class ... Args>
-  bool iterate_nodes(Proxy(protected_node::*get)(auth_type&, bool), auth_type auth,
-    Func func, Args ... args) {
-    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
-    if (!write) return false;
-    //NOTE: 'master_lock' isn't used below because we want to finish the loop
-    //without exiting early for another thread's multi-lock request
-    for (iterator current = write->begin(), end = write->end();
-         current != end; ++current) {
-      assert(current->second.get());
-      //NOTE: if ordering is respected, this should always succeed
-      Proxy this_node = ((*current->second).*get)(auth, true);
-      if (!this_node) return false;
-      (*func)(current->first, *this_node, args...);
-    }
-    return true;
-  }
-
-private:
-  shared_meta_lock   master_lock;
-  protected_node_map all_nodes;
-};
-
-
 template <class Type>
 static const Type &identity(const Type &value) {
   return value;
@@ -444,11 +166,14 @@ bool find_node_local(Node start, const Target &target, auth_type auth,
   assert(master_lock.get());
   std::unordered_set <const void*> visited;
   typedef typename Node::element_type::type node_type;
-  std::queue <typename node_type::shared_node> pending;
-  pending.push(start);
+  //NOTE: the queue holds deferred handles so that copying nodes during the
+  //traversal doesn't contend on the shared reference counts of busy nodes
+  typedef lc::deferred_handle <typename node_type::protected_node> node_handle;
+  std::queue <node_handle> pending;
+  pending.push(node_handle(start));
 
   while (pending.size()) {
-    typename node_type::shared_node next = pending.front();
+    node_handle next = pending.front();
     pending.pop();
     assert(next.get());
     if ((*compare)(*next, target, auth)) {
@@ -461,7 +186,7 @@ bool find_node_local(Node start, const Target &target, auth_type auth,
       for (typename node_type::connected_nodes::iterator current =
            write->out.begin(), end = write->out.end(); current != end; ++current) {
         if (visited.find(current->get()) == visited.end()) {
-          pending.push(*current);
+          pending.push(node_handle(*current));
           visited.insert(current->get());
         }
       }
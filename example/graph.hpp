@@ -0,0 +1,320 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+/* This is the graph structure used by "graph-multi.cpp" and by
+ * "../bench/graph.cpp". See "graph-multi.cpp" for a description of the design.
+ */
+
+#ifndef graph_hpp
+#define graph_hpp
+
+#include <unordered_set>
+#include <unordered_map>
+#include <memory>
+#include <utility>
+#include <cassert>
+
+#include "locking-container.hpp"
+
+
+typedef lc::lock_auth_base::auth_type  auth_type;
+typedef lc::lock_auth_base::order_type order_type;
+typedef lc::shared_meta_lock           shared_meta_lock;
+
+
+template <class Type>
+struct graph_node {
+  typedef Type stored_type;
+  typedef lc::locking_container_base <graph_node> protected_node;
+  typedef std::shared_ptr <protected_node>        shared_node;
+  typedef std::unordered_set <shared_node>        connected_nodes;
+
+  inline graph_node(const stored_type &value) : obj(value) {}
+
+  inline graph_node(stored_type &&value = stored_type()) : obj(std::move(value)) {}
+
+  inline graph_node(graph_node &&other) : out(std::move(other.out)),
+    in(std::move(other.in)), obj(std::move(other.obj)) {}
+
+private:
+  graph_node(const graph_node&);
+  graph_node &operator = (const graph_node&);
+
+public:
+  static inline bool connect_nodes(shared_node left, shared_node right,
+    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
+    bool try_multi = true) {
+    return change_connection_common(&insert_edge, left, right, auth, master_lock, try_multi);
+  }
+
+  static inline bool disconnect_nodes(shared_node left, shared_node right,
+    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
+    bool try_multi = true) {
+    return change_connection_common(&erase_edge, left, right, auth, master_lock, try_multi);
+  }
+
+  //NOTE: this might never get called if there's a circular reference!
+  virtual inline ~graph_node() {}
+
+  connected_nodes out, in;
+  stored_type     obj;
+
+protected:
+  static void insert_edge(connected_nodes &left, const shared_node &right) {
+    left.insert(right);
+  }
+
+  static void erase_edge(connected_nodes &left, const shared_node &right) {
+    left.erase(right);
+  }
+
+  template <class Func>
+  static bool change_connection_common(Func func, shared_node left, shared_node right,
+    auth_type auth = auth_type(), shared_meta_lock master_lock = shared_meta_lock(),
+    bool try_multi = true) {
+    assert(left.get() && right.get());
+    typename protected_node::write_proxy write_l, write_r;
+    if (try_multi && master_lock) {
+      //(the multi-lock is only used if the nodes can't be locked right away)
+      if (!lc::get_two_locks_hybrid(*left, *right, write_l, write_r, auth, *master_lock)) return false;
+    } else {
+      if (!lc::get_two_locks(*left, *right, write_l, write_r, true, auth, master_lock.get())) return false;
+    }
+
+    (*func)(write_l->out, right);
+    (*func)(write_r->in,  left);
+
+    return true;
+  }
+};
+
+
+template <class Type>
+struct graph_head {
+  typedef graph_node <Type>             node;
+  typedef typename node::stored_type    stored_type;
+  typedef typename node::protected_node protected_node;
+  typedef typename node::shared_node    shared_node;
+
+  virtual shared_node get_graph_head(auth_type auth) = 0;
+
+  virtual typename lc::meta_lock_base::write_proxy get_master_lock(auth_type auth)   = 0;
+  virtual typename lc::meta_lock_base::read_proxy  block_master_lock(auth_type auth) = 0;
+  virtual shared_meta_lock show_master_lock() = 0;
+
+  virtual inline ~graph_head() {}
+};
+
+
+//NOTE: 'MetaLock' can be replaced, e.g., to instrument the multi-lock
+template <class Index, class Type, class MetaLock = lc::meta_lock>
+class graph : public graph_head <Type> {
+public:
+  typedef graph_head <Type> base;
+  using typename base::node;
+  using typename base::stored_type;
+  using typename base::protected_node;
+  using typename base::shared_node;
+
+  typedef Index                                        index_type;
+  typedef std::unordered_map <index_type, shared_node> node_map;
+  typedef typename node_map::iterator                  iterator;
+
+  typedef lc::ordered_lock <lc::rw_lock>              lock_type;
+  typedef lc::locking_container <node_map, lock_type> protected_node_map;
+  typedef lc::locking_container <node, lock_type>     locking_node;
+
+  graph(order_type o) : master_lock(new MetaLock), all_nodes(node_map(), o) {}
+
+private:
+  graph(const graph&);
+  graph &operator = (const graph&);
+
+public:
+    inline auth_type get_new_auth() const {
+      return all_nodes.get_new_auth();
+    }
+
+  shared_node get_graph_head(auth_type auth) {
+    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
+    if (!write) return shared_node();
+    return write->size()? write->begin()->second : shared_node();
+  }
+
+  typename lc::meta_lock_base::write_proxy get_master_lock(auth_type auth) {
+    return master_lock? master_lock->get_write_auth(auth) : lc::meta_lock_base::write_proxy();
+  }
+
+  typename lc::meta_lock_base::read_proxy block_master_lock(auth_type auth) {
+    return master_lock? master_lock->get_read_auth(auth) : lc::meta_lock_base::read_proxy();
+  }
+
+  shared_meta_lock show_master_lock() {
+    assert(master_lock.get());
+    return master_lock;
+  }
+
+  inline order_type get_order() const {
+    return all_nodes.get_order();
+  }
+
+  virtual bool connect_nodes(shared_node left, shared_node right, auth_type auth) {
+    //NOTE: this doesn't use 'find_node' so that error returns only pertain to
+    //failed lock operations
+    return node::connect_nodes(left, right, auth, master_lock, !this->get_order());
+  }
+
+  virtual bool disconnect_nodes(shared_node left, shared_node right, auth_type auth) {
+    //NOTE: this doesn't use 'find_node' so that error returns only pertain to
+    //failed lock operations
+    return node::disconnect_nodes(left, right, auth, master_lock, !this->get_order());
+  }
+
+  virtual shared_node find_node(const index_type &index, auth_type auth) {
+    assert(master_lock.get());
+    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
+    if (!write) return shared_node();
+    typename node_map::iterator found = write->find(index);
+    return (found == write->end())? shared_node() : found->second;
+  }
+
+  template <class ... Args>
+  inline bool insert_node(const index_type &index, auth_type auth, Args ... args) {
+    shared_node value(new locking_node(args...));
+    assert(value.get());
+    //NOTE: added nodes must have higher order than the node map itself
+    assert(!all_nodes.get_order() || value->get_order() > all_nodes.get_order());
+    return this->change_node(index, auth, &replace_node, value);
+  }
+
+  virtual bool erase_node(const index_type &index, auth_type auth) {
+    return this->change_node(index, auth, &remove_node);
+  }
+
+  template <class Func, class ... Args>
+  inline bool iterate_nodes_write(auth_type auth, Func func, Args ... args) {
+    return this->iterate_nodes(&protected_node::get_write_auth, auth, func, args...);
+  }
+
+  template <class Func, class ... Args>
+  inline bool iterate_nodes_read(auth_type auth, Func func, Args ... args) {
+    return this->iterate_nodes(&protected_node::get_read_auth, auth, func, args...);
+  }
+
+  virtual ~graph() {
+    auth_type auth(this->get_new_auth());
+    typename protected_node_map::write_proxy write = all_nodes.get_write_auth(auth, false);
+    assert(write);
+    for (typename node_map::iterator current = write->begin(), end = write->end();
+         current != end; ++current) {
+      assert(current->second.get());
+      //NOTE: if it's already locked, that's a serious problem here
+      //NOTE: auth. is only used to appease ordered locks
+      typename node::protected_node::write_proxy this_node = current->second->get_write_auth(auth, false);
+      assert(this_node);
+      //NOTE: doing this prevents a circular reference memory leak
+      this_node->out.clear();
+      this_node->in.clear();
+    }
+  }
+
+protected:
+  static void replace_node(node_map &the_nodes, const index_type &index, shared_node value) {
+    the_nodes[index] = value;
+  }
+
+  static void remove_node(node_map &the_nodes, const index_type &index) {
+    the_nodes.erase(index);
+  }
+
+  template <class Member>
+  bool remove_edges(shared_node value, Member remove_left, Member remove_right, auth_type auth) {
+    assert(master_lock.get());
+    typename node::protected_node::write_proxy left = value->get_write_multi(*master_lock, auth);
+    if (!left) return false;
+    for (typename node::connected_nodes::iterator
+         current = (left->*remove_left).begin(), end = (left->*remove_left).end();
+         current != end; ++current) {
+      assert(current->get());
+      typename node::protected_node::write_proxy right = (*current)->get_write_multi(*master_lock, auth);
+      if (!right) return false;
+      (right->*remove_right).erase(value);
+    }
+    return true;
+  }
+
+  template <class Func, class ... Args>
+  bool change_node(const index_type &index, auth_type auth, Func func, Args ... args) {
+    assert(master_lock.get());
+    shared_node old_node = this->find_node(index, auth);
+    //NOTE: this is in the outer scope so the lock is continuous
+    lc::meta_lock::write_proxy protect_write;
+    if (old_node) {
+      //(boot off all other locks)
+      protect_write = this->get_master_lock(auth);
+      if (!protect_write) return false;
+      //NOTE: these should never fail if 'master_lock' is used properly
+      if (!this->remove_edges(old_node, &node::out, &node::in, auth)) return false;
+      if (!this->remove_edges(old_node, &node::in, &node::out, auth)) return false;
+    }
+    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
+    if (!write) return false;
+    //NOTE: if this results in destruction of the old node, it shouldn't have
+    //any locks on it that will cause problems
+    (*func)(*write, index, args...);
+    return true;
+  }
+
+  template <class Func, class Proxy, class ... Args>
+  bool iterate_nodes(Proxy(protected_node::*get)(auth_type&, bool), auth_type auth,
+    Func func, Args ... args) {
+    typename protected_node_map::write_proxy write = all_nodes.get_write_multi(*master_lock, auth);
+    if (!write) return false;
+    //NOTE: 'master_lock' isn't used below because we want to finish the loop
+    //without exiting early for another thread's multi-lock request
+    for (iterator current = write->begin(), end = write->end();
+         current != end; ++current) {
+      assert(current->second.get());
+      //NOTE: if ordering is respected, this should always succeed
+      Proxy this_node = ((*current->second).*get)(auth, true);
+      if (!this_node) return false;
+      (*func)(current->first, *this_node, args...);
+    }
+    return true;
+  }
+
+private:
+  shared_meta_lock   master_lock;
+  protected_node_map all_nodes;
+};
+
+#endif //graph_hpp
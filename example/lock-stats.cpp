@@ -0,0 +1,100 @@
+/* This is an example of 'lc::stats_lock'. A few threads update a set of
+ * counters, some of which are hot (i.e., contended) and some of which aren't,
+ * while the main thread exports the lock statistics in OpenMetrics format. The
+ * exporter never takes the counters' locks, so it never waits for the workers.
+ * Two of the counters share a name, and they're exported as a single series.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include lock-stats.cpp -o lock-stats -lpthread
+ *
+ * Usage:
+ *   ./lock-stats [output file]
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+#include "lock-stats.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define THREADS    4
+#define COUNTERS   4
+#define OPERATIONS 100000
+
+
+typedef lc::locking_container <long, lc::stats_lock <lc::rw_lock> > counter;
+
+static counter hot(0, "hot");
+static counter *cold[COUNTERS];
+//(same name and type, so they're combined when exported)
+static counter shared0(0, "shared"), shared1(0, "shared");
+
+
+static void worker(int number) {
+  for (int i = 0; i < OPERATIONS; i++) {
+    if (i % 4 == 0) {
+      counter::write_proxy write = hot.get_write();
+      assert(write);
+      ++*write;
+    } else {
+      counter::write_proxy write = cold[number % COUNTERS]->get_write();
+      assert(write);
+      ++*write;
+    }
+    //(occasional non-blocking reads, some of which will fail)
+    if (i % 16 == 0) {
+      counter::read_proxy read = hot.get_read(false);
+    }
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  for (int i = 0; i < COUNTERS; i++) {
+    cold[i] = new counter(0, "cold-" + std::to_string(i));
+  }
+
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&worker, i));
+  }
+
+  //(export while the workers are still running)
+  std::string partial = lc::lock_stats::export_text();
+  assert(partial.size() > 0);
+
+  *shared0.get_write() = 1;
+  *shared1.get_write() = 1;
+  {
+    const std::string text = lc::lock_stats::export_text();
+    const std::string series =
+      "lc_lock_acquisitions_total{container=\"shared\",lock=\"rw_lock\",mode=\"write\"} ";
+    const size_t first = text.find(series);
+    assert(first != std::string::npos);
+    assert(text.compare(first + series.size(), 2, "2\n") == 0);
+    assert(text.find(series, first + 1) == std::string::npos);
+  }
+
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  if (argc > 1) {
+    if (!lc::lock_stats::export_file(argv[1])) {
+      fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[1]);
+      return 1;
+    }
+  } else {
+    fprintf(stdout, "%s", lc::lock_stats::export_text().c_str());
+  }
+
+  for (int i = 0; i < COUNTERS; i++) {
+    delete cold[i];
+  }
+}
@@ -0,0 +1,99 @@
+/* This is an example of 'lc::lock_table', which protects objects that aren't
+ * stored in containers. Several threads move money between accounts that are
+ * allocated in a plain array, using a table with far fewer locks than there are
+ * accounts. Each transfer locks both accounts in the order given by the table,
+ * and the total is checked at the end.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include lock-table.cpp -o lock-table -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <thread>
+#include <vector>
+
+#include "lock-table.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define ACCOUNTS  1000
+#define STRIPES   32
+#define TRANSFERS 100000
+#define THREADS   4
+
+
+//(this could be any type; it doesn't need to know about the table)
+struct account {
+  long balance;
+};
+
+static account accounts[ACCOUNTS];
+
+//NOTE: ordered locks allow both accounts to be locked with deadlock prevention
+typedef lc::lock_table <lc::ordered_lock <lc::rw_lock> > account_table;
+
+static account_table table(STRIPES);
+
+
+static bool transfer(lc::lock_auth_base::auth_type &auth, account &from, account &to,
+  long amount) {
+  account *first = &from, *second = &to;
+  if (table.get_order(first) > table.get_order(second)) std::swap(first, second);
+
+  lc::object_proxy <account> write1 = table.get_write_auth(*first, auth);
+  if (!write1) return false;
+
+  //(a second lock on the same stripe would be rejected)
+  lc::object_proxy <account> write2;
+  if (!table.same_stripe(first, second)) {
+    write2 = table.get_write_auth(*second, auth);
+    if (!write2) return false;
+  }
+
+  from.balance -= amount;
+  to.balance   += amount;
+  return true;
+}
+
+
+static void run_transfers(unsigned int seed) {
+  lc::lock_auth_base::auth_type auth(table.get_new_auth());
+  for (int i = 0; i < TRANSFERS; i++) {
+    int from = rand_r(&seed) % ACCOUNTS, to = rand_r(&seed) % ACCOUNTS;
+    if (from == to) continue;
+    bool success = transfer(auth, accounts[from], accounts[to], rand_r(&seed) % 100);
+    assert(success);
+    (void) success;
+  }
+}
+
+
+int main() {
+  for (int i = 0; i < ACCOUNTS; i++) {
+    accounts[i].balance = 1000;
+  }
+
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&run_transfers, i));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  //NOTE: ordered locks require an auth. object
+  lc::lock_auth_base::auth_type auth(table.get_new_auth());
+  long total = 0;
+  for (int i = 0; i < ACCOUNTS; i++) {
+    lc::object_proxy <const account> read = table.get_read_auth(accounts[i], auth);
+    assert(read);
+    total += read->balance;
+  }
+
+  fprintf(stdout, "total: %li (expected %li), locks: %zu\n", total,
+    (long) ACCOUNTS * 1000, table.get_stripes());
+  return total != (long) ACCOUNTS * 1000;
+}
@@ -16,6 +16,7 @@
 #include <pthread.h>
 
 #include "locking-container.hpp"
+#include "log-sink.hpp"
 //(necessary for non-template source)
 #include "locking-container.inc"
 
@@ -37,6 +38,14 @@ typedef lc::locking_container_base <int> protected_int;
 lc::locking_container <int, LOCK_TYPE0> my_data0(THREADS);
 lc::locking_container <int, LOCK_TYPE1> my_data1;
 
+//(cancelled at exit, so that blocked threads don't have to wait their turn)
+lc::cancel_source exit_threads;
+
+static protected_int::read_proxy read_data(protected_int &data,
+  lc::lock_auth_base::auth_type &auth, bool block);
+static protected_int::write_proxy write_data(protected_int &data,
+  lc::lock_auth_base::auth_type &auth, bool block);
+
 static void send_output(const char *format, ...);
 
 static void *thread(void *nv);
@@ -65,6 +74,9 @@ int main()
     *write = -1;
   } //<-- proxy goes out of scope and unlocks 'my_data' here (you can also 'write.clear()')
 
+  //wake up threads that are still waiting for locks
+  exit_threads.cancel();
+
   for (long i = 0; (unsigned) i < sizeof threads / sizeof(pthread_t); i++) {
     send_output("?join %li\n", i);
     pthread_join(threads[i], NULL);
@@ -73,28 +85,35 @@ int main()
 }
 
 
-//a print function that ensures we have exclusive access to the output
+//a print function that doesn't make the threads wait for each other's output
 static void send_output(const char *format, ...) {
-  //(there is no reasonable reason to allow multiple locks at once.)
-  typedef lc::locking_container <FILE*, lc::dumb_lock> protected_out;
-  //(this is local so that it can't be involved in a deadlock)
-  static protected_out stdout2(stdout);
+  //NOTE: each thread formats its own message, and a background thread does the
+  //writing; no lock is held while formatting or writing
+  static lc::log_sink stdout2(STDOUT_FILENO);
 
   va_list ap;
   va_start(ap, format);
+  stdout2.vprintf(format, ap);
+  va_end(ap);
+}
+
+
+//blocking calls use the 'exit_threads' token so that they fail once it's cancelled
+
+static protected_int::read_proxy read_data(protected_int &data,
+  lc::lock_auth_base::auth_type &auth, bool block) {
+  return block? data.get_read_auth(auth, exit_threads.get_token()) : data.get_read_auth(auth, false);
+}
 
-  //NOTE: authorization isn't important here because it's not possible for the
-  //caller to lock another container while it holds a lock on 'stdout2';
-  //deadlocks aren't an issue with respect to 'stdout2'
-  protected_out::write_proxy write = stdout2.get_write();
-  if (!write) return;
-  vfprintf(*write, format, ap);
+static protected_int::write_proxy write_data(protected_int &data,
+  lc::lock_auth_base::auth_type &auth, bool block) {
+  return block? data.get_write_auth(auth, exit_threads.get_token()) : data.get_write_auth(auth, false);
 }
 
 
 //a simple thread for repeatedly accessing the data
 static void *thread(void *nv) {
-  //(cancelation can be messy...)
+  //(pthread cancelation can be messy; 'exit_threads' is used instead)
   if (pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL) != 0) return NULL;
 
   //NOTE: normally only one auth. should be used; this is just to simulate
@@ -113,7 +132,7 @@ static void *thread(void *nv) {
 
     for (int i = 0; i < THREADS + n; i++) {
       send_output("?read1 %li\n", n);
-      protected_int::read_proxy read1 = my_data1.get_read_auth(auth0, READ_BLOCK);
+      protected_int::read_proxy read1 = read_data(my_data1, auth0, READ_BLOCK);
       if (!read1) {
         send_output("!read1 %li\n", n);
         return NULL;
@@ -125,7 +144,7 @@ static void *thread(void *nv) {
       //NOTE: this should block unless a writer is being locked out (note that
       //if 'lc::w_lock' is used, a read request uses a write lock)
       send_output("?read0 %li\n", n);
-      protected_int::read_proxy read0 = my_data0.get_read_auth(auth0, READ_BLOCK);
+      protected_int::read_proxy read0 = read_data(my_data0, auth0, READ_BLOCK);
       if (!read0) {
         ++fail_r0;
         send_output("!read0 %li\n", n);
@@ -138,7 +157,7 @@ static void *thread(void *nv) {
 
         //if a writer is waiting, this is really asking for a (potential) deadlock
         send_output("?read2 %li\n", n);
-        protected_int::read_proxy read2 = my_data0.get_read_auth(auth0, READ_BLOCK);
+        protected_int::read_proxy read2 = read_data(my_data0, auth0, READ_BLOCK);
         if (!read2) {
           ++fail_r2;
           send_output("!read2 %li\n", n);
@@ -167,7 +186,7 @@ static void *thread(void *nv) {
     //write once
 
     send_output("?write0 %li\n", n);
-    protected_int::write_proxy write0 = my_data0.get_write_auth(auth1, WRITE_BLOCK);
+    protected_int::write_proxy write0 = write_data(my_data0, auth1, WRITE_BLOCK);
     if (!write0) {
       send_output("!write0 %li\n", n);
       return NULL;
@@ -189,7 +208,7 @@ static void *thread(void *nv) {
 
     send_output("?read3 %li\n", n);
     //NOTE: make sure this is 'auth1' used with 'my_data0'!
-    protected_int::read_proxy read3 = my_data0.get_read_auth(auth1, READ_BLOCK);
+    protected_int::read_proxy read3 = read_data(my_data0, auth1, READ_BLOCK);
     if (!read3) {
       send_output("!read3 %li\n", n);
       return NULL;
@@ -199,7 +218,7 @@ static void *thread(void *nv) {
 
     //NOTE: this will never block because 'auth' already holds a write lock
     send_output("?write1 %li\n", n);
-    protected_int::write_proxy write1 = my_data1.get_write_auth(auth1, WRITE_BLOCK);
+    protected_int::write_proxy write1 = write_data(my_data1, auth1, WRITE_BLOCK);
     if (!write1) {
       ++fail_w1;
       send_output("!write1 %li\n", n);
@@ -0,0 +1,86 @@
+/* This is an example of 'lc::persistent_map'. A writer moves money between
+ * accounts, changing two accounts in each version of the map, while readers
+ * take snapshots and add up all of the accounts. The readers never use the
+ * map's lock, and every snapshot must have the same total.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include persistent-map.cpp -o persistent-map -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <thread>
+#include <vector>
+
+#include "persistent-map.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define ACCOUNTS  1000
+#define TRANSFERS 100000
+#define READERS   3
+#define SNAPSHOTS 2000
+
+
+typedef lc::persistent_map <int, long> account_map;
+
+static account_map accounts;
+
+
+struct transfer {
+  transfer(int new_from, int new_to) : from(new_from), to(new_to) {}
+
+  void operator () (account_map::editor &edit) const {
+    long from_balance = 0, to_balance = 0;
+    edit.get(from, from_balance);
+    edit.set(from, from_balance - 1);
+    edit.get(to, to_balance);
+    edit.set(to, to_balance + 1);
+  }
+
+  const int from, to;
+};
+
+
+static void writer() {
+  unsigned int seed = 1;
+  for (int i = 0; i < TRANSFERS; i++) {
+    bool success = accounts.modify(transfer(rand_r(&seed) % ACCOUNTS, rand_r(&seed) % ACCOUNTS));
+    assert(success);
+  }
+}
+
+static void add_balance(long &total, int /*account*/, long balance) {
+  total += balance;
+}
+
+static void reader() {
+  for (int i = 0; i < SNAPSHOTS; i++) {
+    account_map::snapshot current = accounts.get_snapshot();
+    long total = 0;
+    current.for_each(std::bind(&add_balance, std::ref(total),
+      std::placeholders::_1, std::placeholders::_2));
+    assert(current.size() == ACCOUNTS);
+    assert(total == 100 * ACCOUNTS);
+  }
+}
+
+
+int main() {
+  accounts.modify([](account_map::editor &edit) {
+      for (int i = 0; i < ACCOUNTS; i++) edit.set(i, 100);
+    });
+
+  std::vector <std::thread> threads;
+  threads.push_back(std::thread(&writer));
+  for (int i = 0; i < READERS; i++) {
+    threads.push_back(std::thread(&reader));
+  }
+  for (unsigned int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  fprintf(stdout, "transfers: %i, snapshots: %i\n", TRANSFERS, READERS * SNAPSHOTS);
+}
@@ -0,0 +1,95 @@
+/* This is an example of 'lc::pmr_container'. Several threads add and remove
+ * entries in a map whose nodes and strings are allocated from the container's
+ * own memory resource, which only gets large chunks from the global allocator
+ * rather than using it for every allocation. Every so often, the map is
+ * compacted into a new resource. The contents are checked at the end.
+ *
+ * This requires C++17.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++17 -O2 -I../include pmr-container.cpp -o pmr-container -lpthread
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "pmr-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#if __cplusplus >= 201703L
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define THREADS    4
+#define KEYS       1000
+#define OPERATIONS 50000
+#define COMPACT    10000
+
+
+typedef std::pmr::map <int, std::pmr::string> string_map;
+typedef lc::pmr_container <string_map> protected_map;
+
+static protected_map strings;
+
+
+static void worker(int number) {
+  for (int i = 0; i < OPERATIONS; i++) {
+    //(each thread uses its own keys, so the result can be checked)
+    const int key = (i % KEYS) * THREADS + number;
+    protected_map::write_proxy write = strings.get_write();
+    assert(write);
+    if (i % 3 == 2) {
+      write->erase(key);
+    } else {
+      //NOTE: the map passes its allocator to the new string
+      (*write)[key] = "value " + std::to_string(i);
+    }
+    write.clear();
+    if (number == 0 && i % COMPACT == 0) {
+      bool success = strings.compact();
+      assert(success);
+    }
+  }
+}
+
+
+int main() {
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&worker, i));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  //(the expected contents, using the global allocator)
+  std::map <int, std::string> expected;
+  for (int number = 0; number < THREADS; number++) {
+    for (int i = 0; i < OPERATIONS; i++) {
+      const int key = (i % KEYS) * THREADS + number;
+      if (i % 3 == 2) expected.erase(key);
+      else            expected[key] = "value " + std::to_string(i);
+    }
+  }
+
+  protected_map::read_proxy read = strings.get_read();
+  assert(read && read->size() == expected.size());
+  for (string_map::const_iterator current = read->begin(); current != read->end(); ++current) {
+    assert(expected[current->first] == current->second.c_str());
+  }
+
+  fprintf(stdout, "entries: %i\n", (int) read->size());
+}
+
+#else
+
+int main() {
+  fprintf(stderr, "This example requires C++17.\n");
+  return 1;
+}
+
+#endif
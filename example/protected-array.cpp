@@ -0,0 +1,67 @@
+/* This is an example of 'lc::protected_array'. A few threads update individual
+ * sensor readings while the main thread repeatedly adds up all of the readings.
+ * Each update adds 1 to a reading, so the totals must never decrease, and the
+ * final total is checked against the number of updates.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include protected-array.cpp -o protected-array -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <thread>
+#include <vector>
+
+#include "protected-array.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define SENSORS 200000
+#define THREADS 3
+#define UPDATES 100000
+#define TOTALS  100
+
+
+typedef lc::protected_array <double> sensor_array;
+
+//(one lock per 64 sensors)
+static sensor_array sensors(SENSORS, 0.0, 64);
+
+
+static void updater(unsigned int seed) {
+  for (int i = 0; i < UPDATES; i++) {
+    sensor_array::write_proxy write = sensors.get_write(rand_r(&seed) % SENSORS);
+    assert(write);
+    *write += 1.0;
+  }
+}
+
+
+int main() {
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&updater, (unsigned int) i + 1));
+  }
+
+  double last = 0.0;
+  for (int i = 0; i < TOTALS; i++) {
+    double total = 0.0;
+    bool success = sensors.sum(0, sensors.size(), total);
+    assert(success);
+    assert(total >= last);
+    last = total;
+  }
+
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  double total = 0.0;
+  bool success = sensors.sum(0, sensors.size(), total);
+  assert(success && total == (double) THREADS * UPDATES);
+
+  fprintf(stdout, "sensors: %i, blocks: %i, total: %.0f\n", SENSORS,
+    (int) ((SENSORS + sensors.get_block_size() - 1) / sensors.get_block_size()), total);
+}
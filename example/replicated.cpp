@@ -0,0 +1,104 @@
+/* This is an example of 'lc::replicated_container'. Writer threads add values
+ * to a histogram by executing operations, and reader threads check that the
+ * total never decreases in their local replica. At the end, every replica is
+ * brought up to date and the totals are compared with the expected value.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include replicated.cpp -o replicated -lpthread
+ *
+ * Usage:
+ *   ./replicated [replicas]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "replicated-container.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define BUCKETS    16
+#define WRITERS    4
+#define READERS    4
+#define OPERATIONS 20000
+
+
+struct histogram {
+  histogram() : total(0), counts(BUCKETS, 0) {}
+
+  long               total;
+  std::vector <long> counts;
+};
+
+typedef lc::replicated_container <histogram> replicated_histogram;
+
+static std::atomic <bool> finished(false);
+
+
+static void add(histogram &data, int bucket) {
+  ++data.counts[bucket];
+  ++data.total;
+}
+
+static void writer(replicated_histogram *data, int number) {
+  for (int i = 0; i < OPERATIONS; i++) {
+    //NOTE: the operation is applied once per replica, so 'bucket' is captured
+    //by value rather than being computed inside of the operation
+    const int bucket = (number * OPERATIONS + i) % BUCKETS;
+    bool success = data->execute(std::bind(&add, std::placeholders::_1, bucket));
+    assert(success);
+    (void) success;
+  }
+}
+
+static void reader(replicated_histogram *data, long *reads) {
+  long last = 0;
+  while (!finished) {
+    replicated_histogram::read_proxy read = data->get_read();
+    assert(read);
+    assert(read->total >= last);
+    last = read->total;
+    ++*reads;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  const size_t replicas = (argc > 1)? strtoul(argv[1], NULL, 10) : 0;
+  replicated_histogram data(histogram(), replicas);
+
+  fprintf(stdout, "NUMA nodes: %u, replicas: %u\n", (unsigned int) lc::numa_nodes::count(),
+          (unsigned int) data.get_replicas());
+
+  std::vector <std::thread> writers, readers;
+  std::vector <long> reads(READERS, 0);
+  for (int i = 0; i < READERS; i++) {
+    readers.push_back(std::thread(&reader, &data, &reads[i]));
+  }
+  for (int i = 0; i < WRITERS; i++) {
+    writers.push_back(std::thread(&writer, &data, i));
+  }
+  for (int i = 0; i < WRITERS; i++) {
+    writers[i].join();
+  }
+  finished = true;
+  for (int i = 0; i < READERS; i++) {
+    readers[i].join();
+  }
+
+  bool success = data.sync();
+  assert(success);
+  (void) success;
+
+  replicated_histogram::read_proxy read = data.get_read();
+  assert(read && read->total == WRITERS * OPERATIONS);
+  long reads_total = 0;
+  for (int i = 0; i < READERS; i++) reads_total += reads[i];
+  fprintf(stdout, "total: %li, reads: %li, log size: %u\n", read->total, reads_total,
+          (unsigned int) data.get_log_size());
+}
@@ -0,0 +1,70 @@
+/* This is an example of 'lc::task_scheduler', using the dining philosophers
+ * problem. Each meal is a task that needs write locks on two chopsticks. If
+ * either lock fails, the task gives up and is parked on the chopstick that
+ * failed, and it's queued again as soon as that chopstick is released. Nothing
+ * ever blocks for a lock, and nothing waits for an arbitrary amount of time.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include scheduler.cpp -o scheduler -lpthread
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <atomic>
+
+#include "lock-scheduler.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define PHILOSOPHERS 8
+#define MEALS        1000
+#define WORKERS      4
+
+
+//NOTE: 'parking_lock' is what allows tasks to be parked on a chopstick
+typedef lc::locking_container <int, lc::parking_lock <lc::rw_lock> > chopstick;
+
+static chopstick chopsticks[PHILOSOPHERS];
+
+static std::atomic <int> attempts(0);
+
+
+//eat one meal, then queue the next one
+static bool eat(lc::task_scheduler::context &context, int number, int meal) {
+  ++attempts;
+
+  chopstick::write_proxy left = context.get_write(chopsticks[number]);
+  if (!left) return false;
+
+  chopstick::write_proxy right = context.get_write(chopsticks[(number + 1) % PHILOSOPHERS]);
+  if (!right) return false; //<-- 'left' is released here, before the task is parked
+
+  ++*left;
+  ++*right;
+
+  if (meal + 1 < MEALS) {
+    context.submit(std::bind(&eat, std::placeholders::_1, number, meal + 1));
+  }
+  return true;
+}
+
+
+int main() {
+  lc::task_scheduler scheduler(WORKERS);
+
+  for (int i = 0; i < PHILOSOPHERS; i++) {
+    scheduler.submit(std::bind(&eat, std::placeholders::_1, i, 0));
+  }
+
+  scheduler.wait();
+
+  for (int i = 0; i < PHILOSOPHERS; i++) {
+    chopstick::read_proxy read = chopsticks[i].get_read();
+    assert(read);
+    //(each chopstick is used by two philosophers)
+    assert(*read == 2 * MEALS);
+  }
+
+  fprintf(stdout, "meals: %i, attempts: %i\n", PHILOSOPHERS * MEALS, attempts.load());
+}
@@ -0,0 +1,68 @@
+/* This is an example of 'lc::striped_map'. The map starts with a single stripe,
+ * and several threads count words in it. The update function occasionally
+ * sleeps while the stripe is locked, so that stripes become contended even with
+ * a single CPU. As stripes become contended they're split, while the other
+ * threads keep using the map. At the end, the counts are checked against the
+ * expected totals, and the map is checked for splits.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include striped-map.cpp -o striped-map -lpthread
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "striped-map.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define THREADS    4
+#define WORDS      1000
+#define OPERATIONS 200000
+
+
+typedef lc::striped_map <std::string, long> word_counts;
+
+//(1 stripe to start, up to 64; split after 16 of 256 accesses are contended)
+static word_counts counts(1, 64, 1, 256, 16);
+
+
+static void increment(long &count) {
+  //(hold the stripe for a moment, so that the other threads contend for it)
+  if (++count % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(10));
+}
+
+static void worker(int number) {
+  for (int i = 0; i < OPERATIONS; i++) {
+    const std::string word = "word-" + std::to_string((i + number) % WORDS);
+    bool success = counts.update(word, &increment);
+    assert(success);
+  }
+}
+
+
+int main() {
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&worker, i));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  long total = 0;
+  bool success = counts.for_each([&total](const std::string&, long count) { total += count; });
+  assert(success);
+  assert(total == (long) THREADS * OPERATIONS);
+  assert(counts.size() == WORDS);
+  assert(counts.get_splits() > 0);
+  assert(counts.get_stripes() == counts.get_splits() + 1);
+
+  fprintf(stdout, "words: %i, stripes: %i, splits: %i\n", (int) counts.size(),
+    (int) counts.get_stripes(), (int) counts.get_splits());
+}
@@ -0,0 +1,114 @@
+/* This is an example of 'lc::timestamp_lock'. Each operation moves money
+ * between three random accounts, locking them in whatever order they were
+ * chosen, which would normally risk a deadlock. When two operations conflict,
+ * the younger one is made to abort (wound-wait) or aborts itself (wait-die),
+ * and it then retries with its original timestamp. The total amount of money is
+ * checked at the end.
+ *
+ * Suggested compilation command:
+ *   c++ -Wall -pedantic -std=c++11 -O2 -I../include wound-wait.cpp -o wound-wait -lpthread
+ *
+ * Usage:
+ *   ./wound-wait [wound-wait|wait-die]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+#include "timestamp-lock.hpp"
+//(necessary for non-template source)
+#include "locking-container.inc"
+
+#define ACCOUNTS   16
+#define THREADS    4
+#define OPERATIONS 20000
+
+
+typedef lc::timestamp_lock <lc::w_lock> account_lock;
+typedef lc::locking_container <long, account_lock> account;
+
+static std::vector <account*> accounts;
+
+static std::atomic <long> restarts(0);
+
+
+static void transfer(unsigned int seed) {
+  for (int i = 0; i < OPERATIONS; i++) {
+    int chosen[3];
+    chosen[0] = rand_r(&seed) % ACCOUNTS;
+    do chosen[1] = rand_r(&seed) % ACCOUNTS; while (chosen[1] == chosen[0]);
+    do chosen[2] = rand_r(&seed) % ACCOUNTS; while (chosen[2] == chosen[0] || chosen[2] == chosen[1]);
+
+    //(one auth. per operation, so that each operation gets its own timestamp)
+    account::auth_type auth = account::new_auth();
+    lc::lock_auth_timestamp *timestamp = static_cast <lc::lock_auth_timestamp*> (auth.get());
+
+    while (true) {
+      account::write_proxy first = accounts[chosen[0]]->get_write_auth(auth);
+      account::write_proxy second, third;
+      if (first)  second = accounts[chosen[1]]->get_write_auth(auth);
+      if (second) third  = accounts[chosen[2]]->get_write_auth(auth);
+      if (third) {
+        *first  -= 2;
+        *second += 1;
+        *third  += 1;
+        break;
+      }
+      //NOTE: the only reason for failure here is losing a conflict
+      assert(timestamp->aborted());
+      first.clear();
+      second.clear();
+      ++restarts;
+      timestamp->restart();
+      //(give the operation that won a chance to finish)
+      std::this_thread::yield();
+    }
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  account_lock::policy_type policy = account_lock::wound_wait;
+  if (argc > 1) {
+    if (strcmp(argv[1], "wait-die") == 0) {
+      policy = account_lock::wait_die;
+    } else if (strcmp(argv[1], "wound-wait") != 0) {
+      fprintf(stderr, "%s [wound-wait|wait-die]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  for (int i = 0; i < ACCOUNTS; i++) {
+    accounts.push_back(new account(1000, policy));
+  }
+
+  std::vector <std::thread> threads;
+  for (int i = 0; i < THREADS; i++) {
+    threads.push_back(std::thread(&transfer, (unsigned int) i + 1));
+  }
+  for (int i = 0; i < THREADS; i++) {
+    threads[i].join();
+  }
+
+  long total = 0;
+  //NOTE: 'timestamp_lock' always requires an auth. object
+  account::auth_type auth = account::new_auth();
+  for (int i = 0; i < ACCOUNTS; i++) {
+    account::read_proxy read = accounts[i]->get_read_auth(auth);
+    assert(read);
+    total += *read;
+  }
+  for (int i = 0; i < ACCOUNTS; i++) {
+    delete accounts[i];
+  }
+  assert(total == 1000 * ACCOUNTS);
+
+  fprintf(stdout, "operations: %i, restarts: %li\n", THREADS * OPERATIONS, restarts.load());
+}
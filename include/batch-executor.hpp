@@ -0,0 +1,156 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides an executor for batches of operations that each access a
+ * small, known set of containers. The executor orders conflicting operations
+ * before running anything, so that operations that can't possibly conflict run
+ * in parallel and the others run one after another in the order they were
+ * added. The result is the same as running the operations in that order on a
+ * single thread, as long as each operation only accesses the containers it
+ * declares.
+ */
+
+#ifndef lc_batch_executor_hpp
+#define lc_batch_executor_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lock-scheduler.hpp"
+
+namespace lc {
+
+
+/*! \class batch_executor
+ *  \brief Runs batches of operations with declared read and write sets.
+ *
+ * Each operation declares the containers it reads and writes. When the batch is
+ * run, an operation waits for every earlier operation that writes a container
+ * it accesses, and for every earlier operation that reads a container it
+ * writes. The operations are run as \ref task_scheduler tasks, which means that
+ * their lock attempts never block. Within a batch, those attempts can only fail
+ * if something outside of the batch is using the same containers, in which
+ * case the operation is retried as usual for \ref task_scheduler.
+ * \attention add and run must only be called by one thread at a time.
+ */
+
+class batch_executor {
+public:
+  typedef task_scheduler::task_type task_type;
+  typedef lock_auth_base::count_type count_type;
+
+  /*! \class operation
+   *  \brief An operation, along with the containers it accesses.
+   */
+
+  class operation {
+  public:
+    explicit operation(const task_type &new_task);
+
+    /*! Declare that the operation reads 'container'.*/
+    template <class Type>
+    operation &reads(locking_container_base <Type> &container) {
+      return this->access(&container, true);
+    }
+
+    /*! Declare that the operation writes 'container'.*/
+    template <class Type>
+    operation &writes(locking_container_base <Type> &container) {
+      return this->access(&container, false);
+    }
+
+  private:
+    friend class batch_executor;
+
+    typedef std::unordered_map <const void*, bool> access_map;
+
+    operation &access(const void *container, bool read);
+
+    task_type  task;
+    access_map accesses;
+  };
+
+  explicit batch_executor(task_scheduler &new_scheduler);
+
+private:
+  batch_executor(const batch_executor&);
+  batch_executor &operator = (const batch_executor&);
+
+public:
+  /*! Add an operation to the current batch.*/
+  void add(const operation &new_operation);
+
+  /*! Run the current batch, and wait for it to finish.*/
+  void run();
+
+private:
+  struct node {
+    explicit node(const task_type &new_task);
+
+    task_type                task;
+    std::atomic <count_type> pending;
+    std::vector <node*>      dependents;
+  };
+
+  //(the most recent writer, and the readers since then)
+  struct container_state {
+    container_state();
+
+    node                *writer;
+    std::vector <node*>  readers;
+  };
+
+  typedef std::vector <std::unique_ptr <node> >               node_list;
+  typedef std::unordered_map <const void*, container_state> container_map;
+
+  static void add_dependency(node *before, node *after);
+  bool run_node(node *current, task_scheduler::context &context);
+
+  task_scheduler          &scheduler;
+  node_list                nodes;
+  container_map            containers;
+  std::atomic <count_type> remaining;
+  std::mutex               done_lock;
+  std::condition_variable  done_wait;
+};
+
+} //namespace lc
+
+#endif //lc_batch_executor_hpp
@@ -0,0 +1,155 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+#ifndef lc_cancel_token_hpp
+#define lc_cancel_token_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lc {
+
+
+class cancel_source;
+
+
+/*! \class cancel_token
+ *  \brief Handle that allows a blocking lock request to be interrupted.
+ *
+ * Tokens are obtained from a \ref cancel_source, and they can be passed to the
+ * container accessor functions in place of the 'block' argument. The request
+ * then blocks as usual, except that it fails as soon as the source is
+ * cancelled. The interrupted request is removed from the lock's waiters and
+ * from the auth. object without affecting any other waiters. A
+ * default-constructed token is never cancelled.
+ * \attention Only rw_lock, w_lock, adaptive_lock, and priority_lock (and
+ * ordered_lock using one of those) can be interrupted while waiting. Other
+ * locks only check the token before they block.
+ */
+
+class cancel_token {
+public:
+  cancel_token();
+
+  /*! Check if the source of this token has been cancelled.*/
+  bool cancelled() const;
+
+private:
+  struct registration {
+    std::mutex              *lock;
+    std::condition_variable *wait;
+  };
+
+  struct cancel_state {
+    cancel_state();
+
+    std::atomic <bool>           is_cancelled;
+    std::mutex                   state_lock;
+    std::vector <registration*>  waiting;
+  };
+
+  typedef std::shared_ptr <cancel_state> state_type;
+
+public:
+  /*! \class waiting
+   *  \brief Registration of a waiting thread, for use by lock classes.
+   *
+   * While this exists, cancelling the token notifies 'new_wait' while holding
+   * 'new_lock'. This means that a waiter that checks cancelled while holding
+   * 'new_lock' can't miss the cancellation.
+   * \attention This must be created before 'new_lock' is locked, and it must be
+   * destroyed after 'new_lock' is unlocked.
+   */
+
+  class waiting {
+  public:
+    waiting(const cancel_token &token, std::mutex &new_lock,
+      std::condition_variable &new_wait);
+
+    ~waiting();
+
+  private:
+    waiting(const waiting&);
+    waiting &operator = (const waiting&);
+
+    state_type   state;
+    registration current;
+  };
+
+private:
+  friend class cancel_source;
+
+  explicit cancel_token(const state_type &new_state);
+
+  state_type state;
+};
+
+
+/*! \class cancel_source
+ *  \brief Source of \ref cancel_token objects.
+ *
+ * Calling cancel wakes up all requests that are waiting with one of this
+ * source's tokens, and causes all further requests using them to fail.
+ * Cancellation can't be undone.
+ */
+
+class cancel_source {
+public:
+  cancel_source();
+
+private:
+  cancel_source(const cancel_source&);
+  cancel_source &operator = (const cancel_source&);
+
+public:
+  /*! Cancel all tokens from this source.*/
+  void cancel();
+
+  /*! Check if cancel has been called.*/
+  bool cancelled() const;
+
+  /*! Get a new token that refers to this source.*/
+  cancel_token get_token() const;
+
+private:
+  const cancel_token::state_type state;
+};
+
+} //namespace lc
+
+#endif //lc_cancel_token_hpp
@@ -0,0 +1,211 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a container for state where only the latest value
+ * matters, e.g., the current best price. Rather than waiting for the lock,
+ * writers leave their value in a pending slot (replacing any value that hasn't
+ * been installed yet) and return. Whichever thread gets the lock installs the
+ * newest value, which means that many writers cost a single update.
+ */
+
+#ifndef lc_coalescing_container_hpp
+#define lc_coalescing_container_hpp
+
+#include <atomic>
+#include <memory>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class coalescing_container
+ *  \brief Container for last-writer-wins state.
+ *
+ * This is a \ref locking_container with publish functions added. publish
+ * replaces the pending value, and then it installs the pending value if it
+ * can get a write lock without blocking. Otherwise, the pending value is
+ * installed by whichever thread next gets a lock on the container:
+ *
+ * - The thread that installs a value checks the pending slot again after
+ *   unlocking, so a value published while it held the lock isn't left behind.
+ *
+ * - get_write (etc.) installs the pending value before returning the proxy.
+ *
+ * - get_read (etc.) first gets a write lock to install the pending value, if
+ *   there is one, so a read always sees the latest value published before it.
+ *   This means that reads are subject to the rules for write locks when a
+ *   value is pending, and a non-blocking read fails if the pending value can't
+ *   be installed.
+ *
+ * Values that are replaced before they're installed are discarded.
+ */
+
+template <class Type, class Lock = rw_lock>
+class coalescing_container : public locking_container <Type, Lock> {
+private:
+  typedef locking_container <Type, Lock> base;
+
+public:
+  using typename base::type;
+  using typename base::write_proxy;
+  using typename base::read_proxy;
+  using typename base::auth_type;
+  //NOTE: this is needed so that the 'lock_auth_base' variants are pulled in
+  using base::get_write_multi;
+  using base::get_read_multi;
+
+  /*! \brief Constructor.
+   *
+   * @see locking_container::locking_container
+   */
+  explicit coalescing_container() : pending(NULL), superseded(0) {}
+
+  template <class ... Types>
+  explicit coalescing_container(type &&object, Types ... args) :
+    base(std::move(object), args...), pending(NULL), superseded(0) {}
+
+  template <class ... Types>
+  explicit coalescing_container(const type &object, Types ... args) :
+    base(object, args...), pending(NULL), superseded(0) {}
+
+private:
+  coalescing_container(const coalescing_container&);
+  coalescing_container &operator = (const coalescing_container&);
+
+public:
+  /** @name Publishing
+   *
+   */
+  //@{
+
+  /*! \brief Replace the value, without waiting for the lock.*/
+  void publish(const type &value) {
+    this->publish_common(new type(value), NULL);
+  }
+
+  void publish(type &&value) {
+    this->publish_common(new type(std::move(value)), NULL);
+  }
+
+  /*! \brief Replace the value, without waiting for the lock.
+   *
+   * \param auth Authorization object, e.g., if the lock type requires one.
+   */
+  void publish(const type &value, auth_type &auth) {
+    this->publish_common(new type(value), auth.get());
+  }
+
+  void publish(type &&value, auth_type &auth) {
+    this->publish_common(new type(std::move(value)), auth.get());
+  }
+
+  /*! Check if a published value hasn't been installed yet.*/
+  bool has_pending() const {
+    return pending.load() != NULL;
+  }
+
+  /*! Get the number of published values that were discarded.*/
+  unsigned long get_superseded() const {
+    return superseded.load();
+  }
+
+  //@}
+
+  ~coalescing_container() {
+    delete pending.exchange(NULL);
+  }
+
+private:
+  void publish_common(type *value, lock_auth_base *auth) {
+    std::unique_ptr <type> replaced(pending.exchange(value));
+    if (replaced) ++superseded;
+    //(whichever thread gets the lock installs the newest value)
+    while (pending.load()) {
+      write_proxy write = this->base::get_write_multi(NULL, auth, false);
+      if (!write) return;
+      this->install(*write);
+    }
+  }
+
+  void install(type &object) {
+    std::unique_ptr <type> newest(pending.exchange(NULL));
+    if (newest) object = std::move(*newest);
+  }
+
+  write_proxy get_write_multi(lock_base *meta_lock, lock_auth_base *auth, bool block) {
+    write_proxy write = this->base::get_write_multi(meta_lock, auth, block);
+    if (write) this->install(*write);
+    return write;
+  }
+
+  read_proxy get_read_multi(lock_base *meta_lock, lock_auth_base *auth, bool block) {
+    if (!this->install_pending(meta_lock, auth, block, NULL)) return read_proxy();
+    return this->base::get_read_multi(meta_lock, auth, block);
+  }
+
+  write_proxy get_write_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    write_proxy write = this->base::get_write_cancel(meta_lock, auth, cancel);
+    if (write) this->install(*write);
+    return write;
+  }
+
+  read_proxy get_read_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    if (!this->install_pending(meta_lock, auth, true, &cancel)) return read_proxy();
+    return this->base::get_read_cancel(meta_lock, auth, cancel);
+  }
+
+  bool install_pending(lock_base *meta_lock, lock_auth_base *auth, bool block,
+    const cancel_token *cancel) {
+    while (pending.load()) {
+      write_proxy write = cancel? this->base::get_write_cancel(meta_lock, auth, *cancel) :
+                                  this->base::get_write_multi(meta_lock, auth, block);
+      if (!write) return false;
+      this->install(*write);
+    }
+    return true;
+  }
+
+  std::atomic <type*>         pending;
+  std::atomic <unsigned long> superseded;
+};
+
+} //namespace lc
+
+#endif //lc_coalescing_container_hpp
@@ -0,0 +1,168 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a handle for objects owned by 'std::shared_ptr' (e.g.,
+ * containers shared between threads) that doesn't touch the shared reference
+ * count every time it's copied. Each thread holds a single real reference to
+ * each object it has handles for, along with a plain (non-atomic) count of
+ * those handles. When a thread's count for an object drops to zero, the real
+ * reference is kept until the thread reconciles its table, which happens
+ * periodically. This means that copying handles within a thread (e.g., while
+ * traversing a graph) never causes contention on the shared reference count.
+ */
+
+#ifndef lc_deferred_handle_hpp
+#define lc_deferred_handle_hpp
+
+#include <stddef.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace lc {
+
+
+/*! \class deferred_handle_base
+ *  \brief Base class for \ref deferred_handle.
+ */
+
+class deferred_handle_base {
+public:
+  /*! Release the real references that the calling thread no longer uses.*/
+  static void reconcile();
+
+  /*! Get the number of real references held by the calling thread.*/
+  static size_t held_count();
+
+protected:
+  struct entry {
+    std::shared_ptr <void> strong;
+    long                   count;
+    bool                   deferred;
+  };
+
+  static entry *find_entry(const void *key);
+  static entry *add_entry(const void *key, const std::shared_ptr <void> &object);
+  static void release_entry(entry *local);
+
+private:
+  class table;
+
+  static table &current_table();
+};
+
+
+/*! \class deferred_handle
+ *  \brief Reference to a shared object that defers reference counting.
+ *
+ * This can be used in place of 'std::shared_ptr <Type>' within a thread. The
+ * first handle a thread gets for an object increments the shared count, and
+ * copying or destroying handles after that only changes a count owned by the
+ * thread. The shared count is decremented during reconciliation, some time
+ * after the thread's last handle for the object has been destroyed.
+ * \attention A handle must be destroyed by the thread that created it. To pass
+ * an object to another thread, use get_shared, and create a new handle there.
+ * \attention Objects might be kept alive for a while after all of the handles
+ * are gone. Use reconcile if that matters.
+ */
+
+template <class Type>
+class deferred_handle : public deferred_handle_base {
+public:
+  typedef Type element_type;
+
+  deferred_handle() : pointer(NULL), local(NULL) {}
+
+  deferred_handle(const std::shared_ptr <Type> &object) :
+    pointer(object.get()), local(deferred_handle::get_entry(object)) {}
+
+  deferred_handle(const deferred_handle &other) : pointer(other.pointer), local(other.local) {
+    if (local) ++local->count;
+  }
+
+  deferred_handle &operator = (const deferred_handle &other) {
+    //(increment first, in case 'other' is the same handle)
+    if (other.local) ++other.local->count;
+    if (local) release_entry(local);
+    pointer = other.pointer;
+    local   = other.local;
+    return *this;
+  }
+
+  /*! Get a real shared pointer, e.g., to pass to another thread.*/
+  std::shared_ptr <Type> get_shared() const {
+    return local? std::static_pointer_cast <Type> (local->strong) : std::shared_ptr <Type> ();
+  }
+
+  inline Type *get()         const { return  pointer; }
+  inline Type &operator *()  const { return *pointer; }
+  inline Type *operator ->() const { return  pointer; }
+
+  inline operator bool() const {
+    return pointer;
+  }
+
+  inline bool operator ! () const {
+    return !pointer;
+  }
+
+  inline bool operator == (const deferred_handle &equal) const {
+    return pointer == equal.pointer;
+  }
+
+  inline bool operator != (const deferred_handle &equal) const {
+    return pointer != equal.pointer;
+  }
+
+  ~deferred_handle() {
+    if (local) release_entry(local);
+  }
+
+private:
+  static entry *get_entry(const std::shared_ptr <Type> &object) {
+    if (!object) return NULL;
+    entry *found = find_entry(object.get());
+    //NOTE: only a new entry copies 'object', which changes the shared count
+    return found? found : add_entry(object.get(), object);
+  }
+
+  Type  *pointer;
+  entry *local;
+};
+
+} //namespace lc
+
+#endif //lc_deferred_handle_hpp
@@ -0,0 +1,120 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides fork-join access to a single container. A proxy is
+ * obtained as usual by one thread, and the object is then lent to a group of
+ * helper threads that each process one part of it. The helpers never touch the
+ * container or its lock, which means that they don't need auth. objects and
+ * they can't cause lock contention or rejections. All helpers are joined before
+ * the call returns, which means that they can't outlive the lock.
+ */
+
+#ifndef lc_fork_join_hpp
+#define lc_fork_join_hpp
+
+#include <stddef.h>
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "object-proxy.hpp"
+
+namespace lc {
+
+
+/*! \brief Process an object in parallel using an existing proxy.
+ *
+ * The index range [0, size) is split into one contiguous part per thread
+ * ('helpers' new threads, plus the caller), and 'kernel' is called once per
+ * part as 'kernel(object, begin, end, part)', with 'part' in [0, helpers]. Part
+ * boundaries are multiples of 'grain', so that each part starts at an aligned
+ * offset and can be processed with a simple loop that the compiler can
+ * vectorize. Parts are numbered in index order, so per-part results can be
+ * combined in a deterministic order. Fewer parts are used if there isn't at
+ * least 'grain' elements per part.
+ * \attention The kernel only gets 'const' access to the object, even if the
+ * proxy is for writing.
+ *
+ * \param proxy proxy to the object, which stays locked until all parts are done
+ * \param size number of elements in the object
+ * \param helpers number of helper threads to use
+ * \param kernel function to call for each part
+ * \param grain alignment (in elements) of part boundaries
+ * \return number of parts processed, or 0 if 'proxy' isn't valid
+ */
+template <class Type, class Kernel>
+unsigned int parallel_read(const object_proxy <Type> &proxy, size_t size,
+  unsigned int helpers, Kernel kernel, size_t grain = 1024) {
+  //(a copy, so that the lock is held until the helpers are joined)
+  const object_proxy <Type> lent(proxy);
+  if (!lent) return 0;
+  const Type &object = *lent;
+  if (!grain) grain = 1;
+  size_t chunks = (size + grain - 1) / grain;
+  unsigned int parts = helpers + 1;
+  if (chunks < parts) parts = chunks? chunks : 1;
+  //(joins the helpers when destructed, even if 'kernel' or 'std::thread'
+  //throws, since destructing a joinable thread calls std::terminate)
+  struct join_guard {
+    ~join_guard() {
+      for (unsigned int i = 0; i < threads.size(); i++) {
+        if (threads[i].joinable()) threads[i].join();
+      }
+    }
+    std::vector <std::thread> threads;
+  } started;
+  std::vector <std::thread> &threads = started.threads;
+  threads.reserve(parts - 1);
+  size_t begin = 0;
+  for (unsigned int part = 0; part < parts; part++) {
+    //(the first 'chunks % parts' parts get one extra chunk)
+    size_t part_chunks = chunks / parts + (part < chunks % parts);
+    size_t end = begin + part_chunks * grain;
+    if (end > size) end = size;
+    //NOTE: the caller processes the last part itself
+    if (part + 1 < parts) {
+      threads.push_back(std::thread(kernel, std::cref(object), begin, end, part));
+    } else {
+      kernel(object, begin, end, part);
+    }
+    begin = end;
+  }
+  return parts;
+}
+
+} //namespace lc
+
+#endif //lc_fork_join_hpp
@@ -211,6 +211,17 @@ class rw_lock;
 template <>
 class lock_auth <rw_lock> : public lock_auth_rw_lock {};
 
+class adaptive_lock;
+
+//NOTE: 'adaptive_lock' reports exclusive locks as writes when it isn't sharing
+template <>
+class lock_auth <adaptive_lock> : public lock_auth_rw_lock {};
+
+class priority_lock;
+
+template <>
+class lock_auth <priority_lock> : public lock_auth_rw_lock {};
+
 
 /*! \class lock_auth_r_lock
  *
@@ -439,11 +450,38 @@ class lock_auth <ordered_lock <r_lock> > : public lock_auth_ordered_lock <r_lock
 template <>
 class lock_auth <ordered_lock <w_lock> > : public lock_auth_ordered_lock <w_lock> {};
 
+template <>
+class lock_auth <ordered_lock <adaptive_lock> > : public lock_auth_ordered_lock <adaptive_lock> {};
+
+template <>
+class lock_auth <ordered_lock <priority_lock> > : public lock_auth_ordered_lock <priority_lock> {};
+
 //NOTE: this will still only allow one lock at a time; is that what you really want?
 template <>
 class lock_auth <ordered_lock <dumb_lock> > : public lock_auth_ordered_lock <dumb_lock> {};
 
 
+template <lock_auth_base::order_type, class> class static_ordered_lock;
+
+//(the order is still checked at runtime when the lock is requested)
+template <lock_auth_base::order_type Order, class Base>
+class lock_auth <static_ordered_lock <Order, Base> > : public lock_auth <ordered_lock <Base> > {};
+
+
+template <class> class parking_lock;
+
+//(notification doesn't affect authorization)
+template <class Type>
+class lock_auth <parking_lock <Type> > : public lock_auth <Type> {};
+
+
+template <class> class stats_lock;
+
+//(statistics don't affect authorization)
+template <class Type>
+class lock_auth <stats_lock <Type> > : public lock_auth <Type> {};
+
+
 /*! An authorization type that should be acceptable for use with all lock types.*/
 typedef lock_auth <ordered_lock <rw_lock> > lock_auth_max;
 
@@ -0,0 +1,174 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a thread pool for tasks that access containers. A task
+ * never blocks for a lock; instead, a task whose lock attempt fails is parked
+ * on the container that failed, and it's queued again when that container is
+ * unlocked. This means that tasks are retried when they're likely to succeed,
+ * rather than after an arbitrary wait.
+ *
+ * For this to work, the containers must use parking_lock (see locks.hpp). Tasks
+ * that fail on other containers are retried after other queued tasks.
+ */
+
+#ifndef lc_lock_scheduler_hpp
+#define lc_lock_scheduler_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class task_scheduler
+ *  \brief Work-stealing thread pool that parks tasks on blocked containers.
+ *
+ * Each task is a function that gets locks using the \ref task_scheduler::context
+ * passed to it. Those lock attempts never block. If an attempt fails, the task
+ * should release everything and return false; it's then parked on the
+ * container that failed, and it's queued again once that container is
+ * unlocked. The task returns true when it's done.
+ * \attention A task must not modify anything before returning false, since it
+ * will be executed again from the beginning.
+ * \attention Proxies obtained with the context must not outlive the task call.
+ */
+
+class task_scheduler {
+public:
+  class context;
+
+  typedef std::function <bool(context&)> task_type;
+  typedef lock_auth_base::count_type     count_type;
+
+  explicit task_scheduler(unsigned int worker_count = std::thread::hardware_concurrency());
+
+private:
+  task_scheduler(const task_scheduler&);
+  task_scheduler &operator = (const task_scheduler&);
+
+public:
+  /*! Queue a new task.*/
+  void submit(const task_type &task);
+
+  /*! Wait until all submitted tasks have returned true.*/
+  void wait();
+
+  /*! \class context
+   *  \brief Per-worker state passed to tasks.
+   */
+
+  class context {
+  public:
+    /*! Attempt a write lock, recording the container if it fails.*/
+    template <class Type>
+    typename locking_container_base <Type> ::write_proxy get_write(locking_container_base <Type> &container) {
+      release_notifier *notifier = container.get_release_notifier();
+      release_notifier::generation_type generation = this->pre_lock(notifier);
+      typename locking_container_base <Type> ::write_proxy write = container.get_write_auth(auth, false);
+      if (!write) this->lock_failed(notifier, generation);
+      return write;
+    }
+
+    /*! Attempt a read lock, recording the container if it fails.*/
+    template <class Type>
+    typename locking_container_base <Type> ::read_proxy get_read(locking_container_base <Type> &container) {
+      release_notifier *notifier = container.get_release_notifier();
+      release_notifier::generation_type generation = this->pre_lock(notifier);
+      typename locking_container_base <Type> ::read_proxy read = container.get_read_auth(auth, false);
+      if (!read) this->lock_failed(notifier, generation);
+      return read;
+    }
+
+    /*! Queue a new task on the current worker.*/
+    void submit(const task_type &task);
+
+  private:
+    friend class task_scheduler;
+
+    context(task_scheduler &new_owner, unsigned int new_worker);
+    context(const context&);
+    context &operator = (const context&);
+
+    void reset();
+    release_notifier::generation_type pre_lock(release_notifier *notifier) const;
+    void lock_failed(release_notifier *notifier, release_notifier::generation_type generation);
+
+    task_scheduler                   &owner;
+    const unsigned int                worker;
+    lock_auth_base::auth_type         auth;
+    bool                              failed;
+    release_notifier                 *blocker;
+    release_notifier::generation_type blocker_generation;
+  };
+
+  ~task_scheduler();
+
+private:
+  typedef std::deque <task_type*> task_queue;
+
+  struct worker_queue {
+    std::mutex queue_lock;
+    task_queue tasks;
+  };
+
+  typedef std::vector <std::unique_ptr <worker_queue> > queue_list;
+  typedef std::vector <std::thread>                     thread_list;
+
+  void run_worker(unsigned int worker);
+  task_type *next_task(unsigned int worker);
+  void push_task(unsigned int worker, task_type *task, bool front = false);
+  void requeue(task_type *task);
+  void finish_task(task_type *task);
+
+  queue_list                 queues;
+  thread_list                threads;
+  std::atomic <count_type>   queued, outstanding, sleeping;
+  std::atomic <unsigned int> next_queue;
+  bool                       stopping;
+  std::mutex                 idle_lock, done_lock;
+  std::condition_variable    idle_wait, done_wait;
+};
+
+} //namespace lc
+
+#endif //lc_lock_scheduler_hpp
@@ -0,0 +1,306 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a lock wrapper that keeps statistics about how a lock is
+ * used, and an exporter that renders the statistics of all such locks in the
+ * OpenMetrics (Prometheus) text format. The statistics are only ever updated
+ * and read with atomic operations, so exporting them never takes (or waits
+ * for) the locks being measured.
+ */
+
+#ifndef lc_lock_stats_hpp
+#define lc_lock_stats_hpp
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+
+namespace lc {
+
+
+/*! \class lock_stats
+ *  \brief Statistics for one lock, and the registry of all of them.
+ *
+ * Instances are created by \ref stats_lock, and they're registered for as long
+ * as they exist. Use the static export functions to get the current statistics
+ * for all locks; these are reported for each lock (labeled with the name given
+ * to the lock and its type) and for each lock type. Locks with the same name
+ * and type are reported together, since their labels are identical.
+ */
+
+class lock_stats {
+public:
+  //(number of bounded buckets in the wait-time histogram)
+  enum { wait_buckets = 7 };
+
+  /*! Upper bound of a wait-time histogram bucket, in seconds.*/
+  static double wait_bound(int bucket);
+
+  struct snapshot {
+    snapshot();
+
+    unsigned long read_acquisitions, write_acquisitions;
+    //('busy' is contention, 'auth_rejections' is the auth. refusing the lock,
+    //and 'cancellations' is a blocking request that failed while waiting)
+    unsigned long waits, busy, auth_rejections, cancellations;
+    long          readers, writers, waiters;
+    //(not cumulative; the last bucket is for waits above all of the bounds)
+    unsigned long wait_counts[wait_buckets + 1];
+    double        wait_seconds;
+  };
+
+  const std::string &get_name() const;
+  const std::string &get_type() const;
+
+  /*! Get the current statistics for this lock.*/
+  snapshot get_snapshot() const;
+
+  /*! Render all statistics in OpenMetrics text format.*/
+  static std::string export_text();
+
+  /*! \brief Render all statistics into a buffer.
+   *
+   * \return the length of the full text, like snprintf (the output is
+   * truncated, but still terminated, if this is >= size)
+   */
+  static size_t export_text(char *buffer, size_t size);
+
+  /*! \brief Render all statistics into a file.
+   *
+   * The text is written to a temporary file that then replaces 'filename', so
+   * readers never see a partial file.
+   * \return success or failure
+   */
+  static bool export_file(const char *filename);
+
+protected:
+  lock_stats(const std::string &new_name, const std::string &new_type);
+
+  void record_acquire(bool read);
+  void record_wait(std::chrono::steady_clock::duration wait);
+  void record_busy();
+  void record_auth_rejection();
+  void record_cancellation();
+  void record_release(bool read);
+  void begin_wait();
+  void end_wait();
+
+  ~lock_stats();
+
+private:
+  lock_stats(const lock_stats&);
+  lock_stats &operator = (const lock_stats&);
+
+  typedef std::list <const lock_stats*> registry_type;
+  //(rendered labels, and the statistics for those labels)
+  typedef std::vector <std::pair <std::string, snapshot> > row_list;
+
+  static registry_type &get_registry();
+  static std::mutex    &get_registry_lock();
+
+  static void add_row(row_list &rows, const std::string &labels, const snapshot &current);
+  static void render_rows(std::string &text, const std::string &prefix, const row_list &rows);
+  static std::string escape_label(const std::string &value);
+
+  const std::string name, type;
+  registry_type::iterator position;
+
+  std::atomic <unsigned long> read_acquisitions, write_acquisitions, waits, busy;
+  std::atomic <unsigned long> auth_rejections, cancellations;
+  std::atomic <long>          readers, writers, waiters;
+  std::atomic <unsigned long> wait_counts[wait_buckets + 1];
+  std::atomic <unsigned long> wait_nanos;
+};
+
+
+/*! \class lock_type_name
+ *  \brief Name of a lock type, used to label its statistics.
+ *
+ * Specialize this for your own lock types.
+ */
+
+template <class Lock>
+struct lock_type_name {
+  static std::string get() { return "unknown"; }
+};
+
+template <> struct lock_type_name <rw_lock> {
+  static std::string get() { return "rw_lock"; }
+};
+
+template <> struct lock_type_name <r_lock> {
+  static std::string get() { return "r_lock"; }
+};
+
+template <> struct lock_type_name <w_lock> {
+  static std::string get() { return "w_lock"; }
+};
+
+template <> struct lock_type_name <dumb_lock> {
+  static std::string get() { return "dumb_lock"; }
+};
+
+template <> struct lock_type_name <adaptive_lock> {
+  static std::string get() { return "adaptive_lock"; }
+};
+
+template <> struct lock_type_name <priority_lock> {
+  static std::string get() { return "priority_lock"; }
+};
+
+template <> struct lock_type_name <broken_lock> {
+  static std::string get() { return "broken_lock"; }
+};
+
+template <class Base> struct lock_type_name <ordered_lock <Base> > {
+  static std::string get() { return "ordered_lock<" + lock_type_name <Base> ::get() + ">"; }
+};
+
+template <class Base> struct lock_type_name <parking_lock <Base> > {
+  static std::string get() { return "parking_lock<" + lock_type_name <Base> ::get() + ">"; }
+};
+
+template <lock_base::order_type Order, class Base>
+struct lock_type_name <static_ordered_lock <Order, Base> > {
+  static std::string get() {
+    return "static_ordered_lock<" + std::to_string(Order) + "," + lock_type_name <Base> ::get() + ">";
+  }
+};
+
+
+/*! \class stats_lock
+ *  \brief Lock object that keeps statistics about its use.
+ *
+ * This lock is the same as Base (first template argument), except that it
+ * keeps a \ref lock_stats. The first constructor argument is a name for the
+ * lock (e.g., the container's purpose), and the rest are passed to Base, e.g.:
+ *
+ *   lc::locking_container <int, lc::stats_lock <lc::ordered_lock <> > > value(0, "value", 1);
+ *
+ * Blocking requests are first attempted without blocking, so that waits can be
+ * counted and timed. When a request fails, the auth. object (if any) is asked
+ * whether it would have allowed the request, so that its rejections are
+ * counted separately from contention. 'test' requests (e.g., from
+ * multi-locking) aren't counted.
+ * \attention Statistics are labeled by name, so locks sharing a name (e.g., the
+ * default name) are combined when exported.
+ */
+
+template <class Base = rw_lock>
+class stats_lock : public Base, public lock_stats {
+private:
+  typedef Base base;
+
+public:
+  using typename base::count_type;
+
+  template <class ... Types>
+  explicit stats_lock(const std::string &new_name = "unnamed", Types ... args) :
+    base(args...), lock_stats(new_name, lock_type_name <Base> ::get()) {}
+
+  count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false) {
+    if (test) return this->base::lock(auth, read, block, test);
+    return this->lock_common(auth, read, block, NULL);
+  }
+
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false) {
+    if (test) return this->base::lock_cancel(auth, read, cancel, test);
+    return this->lock_common(auth, read, true, &cancel);
+  }
+
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false) {
+    count_type result = this->base::unlock(auth, read, test);
+    if (!test && result >= 0) this->record_release(read);
+    return result;
+  }
+
+private:
+  stats_lock(const stats_lock&);
+  stats_lock &operator = (const stats_lock&);
+
+  count_type lock_common(lock_auth_base *auth, bool read, bool block, const cancel_token *cancel) {
+    count_type result = this->base::lock(auth, read, false, false);
+    if (result < 0 && !this->auth_allows(auth, read, false)) {
+      //(the auth. would reject this even if the lock weren't in use)
+      this->record_auth_rejection();
+      return result;
+    }
+    if (result < 0 && block) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      this->begin_wait();
+      result = cancel? this->base::lock_cancel(auth, read, *cancel, false) :
+                       this->base::lock(auth, read, true, false);
+      this->end_wait();
+      if (result >= 0) {
+        this->record_wait(std::chrono::steady_clock::now() - start);
+      } else if (!this->auth_allows(auth, read, true)) {
+        //(e.g., waiting while holding other locks could cause a deadlock)
+        this->record_auth_rejection();
+      } else {
+        this->record_cancellation();
+      }
+    } else if (result < 0) {
+      this->record_busy();
+    }
+    if (result >= 0) this->record_acquire(read);
+    return result;
+  }
+
+  bool auth_allows(lock_auth_base *auth, bool read, bool must_block) const {
+    if (!auth) return true;
+    return read? auth->guess_read_allowed(must_block, must_block, this->get_order()) :
+                 auth->guess_write_allowed(must_block, must_block, this->get_order());
+  }
+};
+
+template <class Base>
+struct static_lock_order <stats_lock <Base> > : public static_lock_order <Base> {};
+
+} //namespace lc
+
+#endif //lc_lock_stats_hpp
@@ -0,0 +1,340 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a table of locks for protecting objects that can't be
+ * stored in a 'locking_container', e.g., because they're owned by code that
+ * doesn't know about this library. Each object is assigned one of a fixed
+ * number of locks (stripes) based on its address, which means that the memory
+ * used doesn't depend on the number of objects protected. Access to the
+ * objects is via the same proxies used by 'locking_container', with the same
+ * deadlock prevention.
+ */
+
+#ifndef lc_lock_table_hpp
+#define lc_lock_table_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "cancel-token.hpp"
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "object-proxy.hpp"
+#include "meta-lock.hpp"
+
+namespace lc {
+
+
+/*! \class lock_table_factory
+ *  \brief Creates the locks used by \ref lock_table.
+ *
+ * Specialize this if a lock type needs constructor arguments. The order passed
+ * is unique to each stripe in the table. construct is used by containers that
+ * keep their locks in a single array (e.g., \ref protected_array).
+ */
+
+template <class Lock>
+struct lock_table_factory {
+  static Lock *new_lock(lock_base::order_type /*order*/) {
+    return new Lock;
+  }
+
+  static Lock *construct(void *where, lock_base::order_type /*order*/) {
+    return new (where) Lock;
+  }
+};
+
+template <class Base>
+struct lock_table_factory <ordered_lock <Base> > {
+  static ordered_lock <Base> *new_lock(lock_base::order_type order) {
+    return new ordered_lock <Base> (order);
+  }
+
+  static ordered_lock <Base> *construct(void *where, lock_base::order_type order) {
+    return new (where) ordered_lock <Base> (order);
+  }
+};
+
+
+/*! \class lock_table
+ *  \brief Striped locks for objects that aren't in a container.
+ *
+ * The \ref lock_table::get_write and \ref lock_table::get_read functions are
+ * the same as those of \ref locking_container, except that they take the
+ * object to be locked as an argument. The object's address determines which
+ * lock is used; the object itself is never touched by the table.
+ *
+ * If the lock type is \ref ordered_lock, each stripe is given its own order,
+ * starting at the order passed to the constructor. Use get_order to find out
+ * the order an object will be locked with.
+ * \attention Different objects can share a stripe, in which case locking them
+ * both is the same as locking a single container twice, e.g., the second
+ * write lock will be rejected when using an auth. object. Use same_stripe to
+ * check for this.
+ * \attention All code that accesses a given object must use the same table.
+ */
+
+template <class Lock = rw_lock>
+class lock_table {
+private:
+  typedef lock_auth <Lock> auth_base_type;
+
+public:
+  typedef Lock                       lock_type;
+  typedef lock_auth_base::auth_type  auth_type;
+  typedef lock_auth_base::order_type order_type;
+
+  /*! \brief Constructor.
+   *
+   * \param stripes number of locks in the table.
+   * \param first_order order of the first stripe (ordered locks only).
+   */
+  explicit lock_table(size_t stripes = 64, order_type first_order = 1) {
+    if (!stripes) stripes = 1;
+    locks.reserve(stripes);
+    for (size_t i = 0; i < stripes; i++) {
+      locks.emplace_back(lock_table_factory <Lock> ::new_lock(first_order + i));
+    }
+  }
+
+private:
+  lock_table(const lock_table&);
+  lock_table &operator = (const lock_table&);
+
+public:
+  /** @name Accessor Functions
+   *
+   */
+  //@{
+
+  /*! \brief Retrieve a writable proxy to 'object'.
+   *
+   * @see locking_container_base::get_write
+   * \param object object to lock
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <Type> get_write(Type &object, bool block = true) {
+    return this->get_write_multi(object, NULL, NULL, block, NULL);
+  }
+
+  /*! \brief Retrieve a read-only proxy to 'object'.
+   *
+   * @see locking_container_base::get_read
+   * \param object object to lock
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <const Type> get_read(const Type &object, bool block = true) {
+    return this->get_read_multi(object, NULL, NULL, block, NULL);
+  }
+
+  /*! \brief Retrieve a writable proxy to 'object' using deadlock prevention.
+   *
+   * @see locking_container_base::get_write_auth
+   * \param object object to lock
+   * \param auth Authorization object to prevent deadlocks.
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <Type> get_write_auth(Type &object, auth_type &auth,
+    bool block = true) {
+    if (!auth) return object_proxy <Type> ();
+    return this->get_write_multi(object, NULL, auth.get(), block, NULL);
+  }
+
+  /*! \brief Retrieve a read-only proxy to 'object' using deadlock prevention.
+   *
+   * @see locking_container_base::get_read_auth
+   * \param object object to lock
+   * \param auth Authorization object to prevent deadlocks.
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <const Type> get_read_auth(const Type &object, auth_type &auth,
+    bool block = true) {
+    if (!auth) return object_proxy <const Type> ();
+    return this->get_read_multi(object, NULL, auth.get(), block, NULL);
+  }
+
+  /*! \brief Retrieve a writable proxy to 'object' using deadlock prevention
+   *  and multiple locking functionality.
+   *
+   * @see locking_container_base::get_write_multi
+   * \param object object to lock
+   * \param meta_lock Multi-lock object to manage multiple locks.
+   * \param auth Authorization object to prevent deadlocks.
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <Type> get_write_multi(Type &object, meta_lock_base &meta_lock,
+    auth_type &auth, bool block = true) {
+    if (!auth) return object_proxy <Type> ();
+    return this->get_write_multi(object, meta_lock.get_lock_object(), auth.get(), block, NULL);
+  }
+
+  /*! \brief Retrieve a read-only proxy to 'object' using deadlock prevention
+   *  and multiple locking functionality.
+   *
+   * @see locking_container_base::get_read_multi
+   * \param object object to lock
+   * \param meta_lock Multi-lock object to manage multiple locks.
+   * \param auth Authorization object to prevent deadlocks.
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <const Type> get_read_multi(const Type &object,
+    meta_lock_base &meta_lock, auth_type &auth, bool block = true) {
+    if (!auth) return object_proxy <const Type> ();
+    return this->get_read_multi(object, meta_lock.get_lock_object(), auth.get(), block, NULL);
+  }
+
+  /*! \brief Retrieve a writable proxy to 'object' using deadlock prevention,
+   *  giving up if 'cancel' is cancelled.
+   *
+   * @see locking_container_base::get_write_auth
+   * \param object object to lock
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <Type> get_write_auth(Type &object, auth_type &auth,
+    const cancel_token &cancel) {
+    if (!auth) return object_proxy <Type> ();
+    return this->get_write_multi(object, NULL, auth.get(), true, &cancel);
+  }
+
+  /*! \brief Retrieve a read-only proxy to 'object' using deadlock prevention,
+   *  giving up if 'cancel' is cancelled.
+   *
+   * @see locking_container_base::get_read_auth
+   * \param object object to lock
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  template <class Type>
+  inline object_proxy <const Type> get_read_auth(const Type &object, auth_type &auth,
+    const cancel_token &cancel) {
+    if (!auth) return object_proxy <const Type> ();
+    return this->get_read_multi(object, NULL, auth.get(), true, &cancel);
+  }
+
+  //@}
+
+  /** @name Authorization
+   *
+   */
+  //@{
+
+  /*! Get a new authorization object.*/
+  auth_type get_new_auth() const {
+    return lock_table::new_auth();
+  }
+
+  /*! Get a new authorization object.*/
+  static auth_type new_auth() {
+    return auth_type(new auth_base_type);
+  }
+
+  /*! Get the order that 'object' will be locked with.*/
+  order_type get_order(const void *object) const {
+    return this->get_lock(object)->get_order();
+  }
+
+  /*! Check if two objects are protected by the same lock.*/
+  bool same_stripe(const void *left, const void *right) const {
+    return this->get_index(left) == this->get_index(right);
+  }
+
+  /*! Get the number of locks in the table.*/
+  size_t get_stripes() const {
+    return locks.size();
+  }
+
+  //@}
+
+private:
+  template <class Type>
+  inline object_proxy <Type> get_write_multi(Type &object, lock_base *meta_lock,
+    lock_auth_base *auth, bool block, const cancel_token *cancel) {
+    return object_proxy <Type> (&object, this->get_lock(&object), auth, false, block,
+      meta_lock, cancel);
+  }
+
+  template <class Type>
+  inline object_proxy <const Type> get_read_multi(const Type &object, lock_base *meta_lock,
+    lock_auth_base *auth, bool block, const cancel_token *cancel) {
+    return object_proxy <const Type> (&object, this->get_lock(&object), auth, true, block,
+      meta_lock, cancel);
+  }
+
+  size_t get_index(const void *object) const {
+    //NOTE: the low bits are mostly determined by alignment, so they're mixed
+    //with the higher bits before choosing a stripe
+    uintptr_t value = (uintptr_t) object;
+    value ^= (value >> 4) ^ (value >> 12) ^ (value >> 20);
+    return value % locks.size();
+  }
+
+  Lock *get_lock(const void *object) const {
+    return locks[this->get_index(object)].get();
+  }
+
+  std::vector <std::unique_ptr <Lock> > locks;
+};
+
+} //namespace lc
+
+#endif //lc_lock_table_hpp
@@ -93,6 +93,7 @@
 
 #include <utility>
 
+#include "cancel-token.hpp"
 #include "locks.hpp"
 #include "lock-auth.hpp"
 #include "object-proxy.hpp"
@@ -211,6 +212,98 @@ public:
 
   //@}
 
+  /** @name Cancellable Accessor Functions
+   *
+   * These are the same as the functions above, except that they always block,
+   * and they fail if 'cancel' is cancelled before the lock is obtained. See
+   * \ref cancel_token for the lock types that can be interrupted while waiting.
+   */
+  //@{
+
+  /*! \brief Retrieve a writable proxy, giving up if 'cancel' is cancelled.
+   *
+   * @see get_write
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline write_proxy get_write(const cancel_token &cancel) {
+    return this->get_write_cancel(NULL, NULL, cancel);
+  }
+
+  /*! \brief Retrieve a read-only proxy, giving up if 'cancel' is cancelled.
+   *
+   * @see get_read
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline read_proxy get_read(const cancel_token &cancel) {
+    return this->get_read_cancel(NULL, NULL, cancel);
+  }
+
+  /*! \brief Retrieve a writable proxy using deadlock prevention, giving up if
+   *  'cancel' is cancelled.
+   *
+   * @see get_write_auth
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline write_proxy get_write_auth(auth_type &auth, const cancel_token &cancel) {
+    if (!auth) return write_proxy();
+    return this->get_write_cancel(NULL, auth.get(), cancel);
+  }
+
+  /*! \brief Retrieve a read-only proxy using deadlock prevention, giving up if
+   *  'cancel' is cancelled.
+   *
+   * @see get_read_auth
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline read_proxy get_read_auth(auth_type &auth, const cancel_token &cancel) {
+    if (!auth) return read_proxy();
+    return this->get_read_cancel(NULL, auth.get(), cancel);
+  }
+
+  /*! \brief Retrieve a writable proxy using multiple locking functionality,
+   *  giving up if 'cancel' is cancelled.
+   *
+   * @see get_write_multi
+   * \param meta_lock Multi-lock object to manage multiple locks.
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline write_proxy get_write_multi(meta_lock_base &meta_lock,
+    auth_type &auth, const cancel_token &cancel) {
+    if (!auth) return write_proxy();
+    return this->get_write_cancel(meta_lock.get_lock_object(), auth.get(), cancel);
+  }
+
+  /*! \brief Retrieve a read-only proxy using multiple locking functionality,
+   *  giving up if 'cancel' is cancelled.
+   *
+   * @see get_read_multi
+   * \param meta_lock Multi-lock object to manage multiple locks.
+   * \param auth Authorization object to prevent deadlocks.
+   * \param cancel Token used to interrupt the wait.
+   *
+   * \return proxy object
+   */
+  inline read_proxy get_read_multi(meta_lock_base &meta_lock,
+    auth_type &auth, const cancel_token &cancel) {
+    if (!auth) return read_proxy();
+    return this->get_read_cancel(meta_lock.get_lock_object(), auth.get(), cancel);
+  }
+
+  //@}
+
   /*! Get a new authorization object.*/
   virtual auth_type get_new_auth() const {
     return auth_type();
@@ -221,6 +314,11 @@ public:
     return 0;
   }
 
+  /*! Get the container's release notifier, if the lock type has one.*/
+  virtual release_notifier *get_release_notifier() {
+    return NULL;
+  }
+
   virtual inline ~locking_container_base() {}
 
 protected:
@@ -236,6 +334,27 @@ protected:
     lock_auth_base* /*auth*/, bool /*block*/) {
     return read_proxy();
   }
+
+  /*! \brief Block for a write lock, unless 'cancel' is cancelled first.
+   *
+   * 'meta_lock' is NULL if no multi-lock is used. The default only checks
+   * 'cancel' before blocking, i.e., the same as a lock that can't be
+   * interrupted.
+   */
+  virtual write_proxy get_write_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    if (cancel.cancelled()) return write_proxy();
+    return meta_lock? this->get_write_multi(meta_lock, auth, true) :
+                      this->get_write_auth(auth, true);
+  }
+
+  /*! Block for a read lock, unless 'cancel' is cancelled first.*/
+  virtual read_proxy get_read_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    if (cancel.cancelled()) return read_proxy();
+    return meta_lock? this->get_read_multi(meta_lock, auth, true) :
+                      this->get_read_auth(auth, true);
+  }
 };
 
 
@@ -316,9 +435,30 @@ public:
     return locks.get_order();
   }
 
+  /*! Get the container's lock, e.g., to inspect an adaptive_lock's mode.*/
+  const Lock &get_lock() const {
+    return locks;
+  }
+
+  /*! Get the container's release notifier (e.g., if it uses parking_lock).*/
+  release_notifier *get_release_notifier() {
+    return locking_container::as_notifier(&locks);
+  }
+
   //@}
 
 private:
+  template <class, class> friend class coalescing_container;
+
+  //(this selects the first overload only if 'Lock' is a 'release_notifier')
+  static inline release_notifier *as_notifier(release_notifier *notifier) {
+    return notifier;
+  }
+
+  static inline release_notifier *as_notifier(...) {
+    return NULL;
+  }
+
   inline write_proxy get_write_auth(lock_auth_base *auth, bool block) {
     return this->get_write_multi(NULL, auth, block);
   }
@@ -337,6 +477,16 @@ private:
     return read_proxy(&contained, &locks, auth, true, block, meta_lock);
   }
 
+  inline write_proxy get_write_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    return write_proxy(&contained, &locks, auth, false, true, meta_lock, &cancel);
+  }
+
+  inline read_proxy get_read_cancel(lock_base *meta_lock, lock_auth_base *auth,
+    const cancel_token &cancel) {
+    return read_proxy(&contained, &locks, auth, true, true, meta_lock, &cancel);
+  }
+
   type contained;
   Lock locks;
 };
@@ -403,16 +553,78 @@ bool get_two_locks(locking_container_base <Type1> &object1,
   proxy2.clear();
   bool order = object1.get_order() <= object2.get_order();
   if (order) {
-    if (!auto_get_lock(object1, auth, master_lock, proxy1)) return false;
-    if (!auto_get_lock(object2, auth, master_lock, proxy2)) proxy1.clear();
+    if (!auto_get_lock(object1, auth, master_lock, proxy1, block)) return false;
+    if (!auto_get_lock(object2, auth, master_lock, proxy2, block)) proxy1.clear();
   } else {
-    if (!auto_get_lock(object2, auth, master_lock, proxy2)) return false;
-    if (!auto_get_lock(object1, auth, master_lock, proxy1)) proxy2.clear();
+    if (!auto_get_lock(object2, auth, master_lock, proxy2, block)) return false;
+    if (!auto_get_lock(object1, auth, master_lock, proxy1, block)) proxy2.clear();
   }
   return proxy1 && proxy2;
 }
 
 
+/*! \brief Attempt to lock two containers, only taking a multi-lock if needed.
+ *
+ * This first attempts both locks without blocking (see \ref get_two_locks).
+ * If either attempt fails, both proxies are cleared, and a write lock on
+ * 'master_lock' is requested before blocking for both locks. This means that
+ * other threads only have to stop for the multi-lock when there's an actual
+ * conflict.
+ * \attention 'auth' should hold no other locks, since the write lock on
+ * 'master_lock' will be rejected otherwise.
+ *
+ * \param object1 first object to lock
+ * \param object2 second object to lock
+ * \param proxy1 return proxy for the first lock
+ * \param proxy2 return proxy for the second lock
+ * \param auth authorization object
+ * \param master_lock multi-lock tracking object
+ * \return success or failure, based entirely on locking success
+ */
+template <class Type1, class Type2, class Proxy1, class Proxy2>
+bool get_two_locks_hybrid(locking_container_base <Type1> &object1,
+                          locking_container_base <Type2> &object2,
+  Proxy1 &proxy1, Proxy2 &proxy2, lock_auth_base::auth_type auth,
+  meta_lock_base &master_lock) {
+  if (get_two_locks(object1, object2, proxy1, proxy2, false, auth, &master_lock)) return true;
+  meta_lock_base::write_proxy multi = master_lock.get_write_auth(auth);
+  if (!multi) return false;
+  return get_two_locks(object1, object2, proxy1, proxy2, true, auth, &master_lock);
+} //<-- 'multi' is released here, after both locks have been obtained
+
+
+/*! \brief Lock two containers whose orders are fixed at compile time.
+ *
+ * This is the same as \ref get_two_locks, except that both containers must use
+ * \ref static_ordered_lock (possibly inside of \ref parking_lock), and
+ * 'object1' must have the lower order. The order is checked when compiling
+ * rather than compared on each call, and the locks are always requested in the
+ * order of the arguments.
+ *
+ * \param object1 first object to lock (lower order)
+ * \param object2 second object to lock (higher order)
+ * \param proxy1 return proxy for the first lock
+ * \param proxy2 return proxy for the second lock
+ * \param auth authorization object
+ * \param block whether or not to block when locking the containers
+ * \return success or failure, based entirely on locking success
+ */
+template <class Type1, class Lock1, class Type2, class Lock2, class Proxy1, class Proxy2>
+bool get_two_locks_static(locking_container <Type1, Lock1> &object1,
+                          locking_container <Type2, Lock2> &object2,
+  Proxy1 &proxy1, Proxy2 &proxy2, lock_auth_base::auth_type auth, bool block = true) {
+  static_assert(static_lock_order <Lock1> ::value && static_lock_order <Lock2> ::value,
+    "both containers must use static_ordered_lock");
+  static_assert(static_lock_order <Lock1> ::value < static_lock_order <Lock2> ::value,
+    "the first container must have the lower order");
+  proxy1.clear();
+  proxy2.clear();
+  if (!auto_get_lock(object1, auth, NULL, proxy1, block)) return false;
+  if (!auto_get_lock(object2, auth, NULL, proxy2, block)) proxy1.clear();
+  return proxy1 && proxy2;
+}
+
+
 /*! \brief Attempt to copy one container's contents into another.
  *
  * @note This will attempt to obtain locks for both containers, and will fail if
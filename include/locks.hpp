@@ -36,14 +36,23 @@
 #ifndef lc_locks_hpp
 #define lc_locks_hpp
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include <assert.h>
 
 #include "lock-auth.hpp"
+#include "cancel-token.hpp"
 
 namespace lc {
 
@@ -63,6 +72,11 @@ public:
   /*! Return < 0 must mean failure. Should return the current number of read locks on success.*/
   virtual count_type unlock(lock_auth_base *auth, bool read, bool test = false) = 0;
 
+  /*! Same as a blocking lock, except that it fails if 'cancel' is cancelled
+   *  while waiting. By default, 'cancel' is only checked before blocking.*/
+  virtual count_type lock_cancel(lock_auth_base *auth, bool read,
+    const cancel_token &cancel, bool test = false);
+
   virtual order_type get_order() const;
 
 protected:
@@ -74,6 +88,10 @@ protected:
   static inline void release_auth(lock_auth_base *auth, unlock_data &l) {
     if (auth) auth->release_auth(l);
   }
+
+  static inline bool is_cancelled(const cancel_token *cancel) {
+    return cancel && cancel->cancelled();
+  }
 };
 
 
@@ -103,10 +121,15 @@ private:
 public:
   count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false);
   count_type unlock(lock_auth_base *auth, bool read, bool test = false);
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false);
 
   ~rw_lock();
 
 private:
+  count_type lock_common(std::unique_lock <std::mutex> &local_lock, lock_auth_base *auth,
+    bool read, bool block, bool test, const cancel_token *cancel);
+
   count_type               readers, readers_waiting;
   bool                     writer, writer_waiting;
   const void              *the_writer;
@@ -168,9 +191,15 @@ public:
 
   count_type unlock(lock_auth_base *auth, bool read, bool test = false);
 
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false);
+
   ~w_lock();
 
 private:
+  count_type lock_common(std::unique_lock <std::mutex> &local_lock, lock_auth_base *auth,
+    bool block, bool test, const cancel_token *cancel);
+
   bool                    writer;
   count_type              writers_waiting;
   std::mutex              master_lock;
@@ -213,6 +242,12 @@ public:
     return this->base::unlock(auth, read, test);
   }
 
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false) {
+    if (!auth) return -1;
+    return this->base::lock_cancel(auth, read, cancel, test);
+  }
+
   virtual order_type get_order() const {
     return order;
   }
@@ -225,6 +260,150 @@ private:
 };
 
 
+/*! \class static_ordered_lock
+ *  \brief Lock object with an order that's fixed at compile time.
+ *
+ * This is the same as \ref ordered_lock, except that the order is a template
+ * argument, so it isn't stored in the lock. Use this when container orders are
+ * fixed by design. Containers using this lock can be locked together with
+ * \ref get_two_locks_static, which checks the locking order at compile time.
+ * \attention This lock will not allow locks without an auth. object.
+ */
+
+template <lock_base::order_type Order, class Base = rw_lock>
+class static_ordered_lock : public Base {
+private:
+  typedef Base base;
+
+  static_assert(Order > 0, "an order of 0 means that the lock is unordered");
+
+public:
+  using typename base::count_type;
+  using typename base::order_type;
+
+  static_ordered_lock() {}
+
+  count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false) {
+    if (!auth) return -1;
+    return this->base::lock(auth, read, block, test);
+  }
+
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false) {
+    if (!auth) return -1;
+    return this->base::unlock(auth, read, test);
+  }
+
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false) {
+    if (!auth) return -1;
+    return this->base::lock_cancel(auth, read, cancel, test);
+  }
+
+  virtual order_type get_order() const {
+    return Order;
+  }
+
+private:
+  static_ordered_lock(const static_ordered_lock&);
+  static_ordered_lock &operator = (const static_ordered_lock&);
+};
+
+
+/*! \class static_lock_order
+ *  \brief Compile-time order of a lock type (0 if it isn't fixed).
+ */
+
+template <class Lock>
+struct static_lock_order {
+  static const lock_base::order_type value = 0;
+};
+
+template <lock_base::order_type Order, class Base>
+struct static_lock_order <static_ordered_lock <Order, Base> > {
+  static const lock_base::order_type value = Order;
+};
+
+
+/*! \class release_notifier
+ *  \brief Notifies callbacks when a lock is released.
+ *
+ * This is used by \ref task_scheduler to retry a task right after the lock
+ * that blocked it has been released. To avoid missing a release, the caller
+ * should read get_generation before attempting the lock, then pass that value
+ * to park if the attempt fails.
+ */
+
+class release_notifier {
+public:
+  typedef unsigned long           generation_type;
+  typedef std::function <void()>  callback_type;
+
+  release_notifier();
+
+private:
+  release_notifier(const release_notifier&);
+  release_notifier &operator = (const release_notifier&);
+
+public:
+  /*! Get the number of releases so far.*/
+  generation_type get_generation() const;
+
+  /*! Call 'callback' after the next release, or call it right away if there
+   *  has been a release since get_generation returned 'seen'.*/
+  void park(generation_type seen, const callback_type &callback);
+
+  virtual ~release_notifier();
+
+protected:
+  /*! Must be called after every unlock, without holding any locks.*/
+  void notify_release();
+
+private:
+  typedef std::vector <callback_type> callback_list;
+
+  std::atomic <generation_type> generation;
+  std::atomic <unsigned long>   parked_count;
+  std::mutex                    parked_lock;
+  callback_list                 parked;
+};
+
+
+/*! \class parking_lock
+ *  \brief Lock object that notifies parked callbacks when it's released.
+ *
+ * This lock is the same as Base (first template argument), except that it also
+ * acts as a \ref release_notifier. Use this for containers that are accessed by
+ * \ref task_scheduler tasks. Note that callbacks are executed by the thread that
+ * unlocks, after the lock has been released.
+ */
+
+template <class Base = rw_lock>
+class parking_lock : public Base, public release_notifier {
+private:
+  typedef Base base;
+
+public:
+  using typename base::count_type;
+
+  template <class ... Types>
+  explicit parking_lock(Types ... args) : base(args...) {}
+
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false) {
+    count_type new_readers = this->base::unlock(auth, read, test);
+    //NOTE: this also needs to happen after test unlocks from a multi-lock
+    this->notify_release();
+    return new_readers;
+  }
+
+private:
+  parking_lock(const parking_lock&);
+  parking_lock &operator = (const parking_lock&);
+};
+
+template <class Base>
+struct static_lock_order <parking_lock <Base> > : public static_lock_order <Base> {};
+
+
 /*! \class dumb_lock
  *  \brief Lock object that doesn't track readers and writers.
  *
@@ -257,6 +436,225 @@ private:
 };
 
 
+/*! \class adaptive_lock
+ *  \brief Lock object that changes its locking strategy based on its usage.
+ *
+ * This lock samples the mix of read and write requests, how often a request
+ * has to wait, and how long the lock is held. After every 'window' successful
+ * locks it picks a strategy for the next window, then switches to it the next
+ * time no thread holds or is waiting for the lock. The strategies are:
+ *
+ *   - read_shared: The same behavior as rw_lock. This is chosen when most of
+ *     the requests are for reading.
+ *
+ *   - exclusive_spin: The same behavior as w_lock, except that a waiting thread
+ *     yields a few times before it goes to sleep. This is chosen for write-heavy
+ *     use with short hold times or little contention.
+ *
+ *   - exclusive_queue: The same behavior as w_lock, except that waiting threads
+ *     are woken one at a time in the order they arrived. This is chosen for
+ *     write-heavy use with long hold times and a lot of contention.
+ *
+ * For the purposes of deadlock prevention, the lock reports its state the same
+ * way as the lock it's currently emulating. This means that the exclusive
+ * strategies treat all locks as write locks (see w_lock). Use a fixed 'window'
+ * of 0 to disable switching.
+ */
+
+class adaptive_lock : public lock_base {
+public:
+  using lock_base::count_type;
+
+  enum mode_type {
+    read_shared,
+    exclusive_spin,
+    exclusive_queue
+  };
+
+  /*! Counts for the current sampling window, returned by get_stats.*/
+  struct stats_type {
+    mode_type     mode, next_mode;
+    count_type    reads, writes, contended, switches;
+    unsigned long mean_hold_ns;
+  };
+
+  adaptive_lock(mode_type initial = read_shared, count_type new_window = 256);
+
+private:
+  adaptive_lock(const adaptive_lock&);
+  adaptive_lock &operator = (const adaptive_lock&);
+
+public:
+  count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false);
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false);
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false);
+
+  /*! Get the strategy currently in use.*/
+  mode_type get_mode() const;
+
+  /*! Get the strategy statistics for the current sampling window.*/
+  stats_type get_stats() const;
+
+  ~adaptive_lock();
+
+private:
+  //NOTE: waiters are on the stacks of the waiting threads, and they're linked
+  //together, so that an idle lock doesn't need any allocated memory
+  struct queued_waiter {
+    queued_waiter() : next(NULL) {}
+
+    std::condition_variable  wait;
+    queued_waiter           *next;
+  };
+
+  typedef std::chrono::steady_clock clock_type;
+
+  count_type lock_shared(std::unique_lock <std::mutex> &local_lock,
+    lock_auth_base *auth, bool read, bool block, bool test, const cancel_token *cancel);
+  count_type lock_exclusive(std::unique_lock <std::mutex> &local_lock,
+    lock_auth_base *auth, bool read, bool block, bool test, const cancel_token *cancel,
+    queued_waiter *waiter);
+  count_type unlock_shared(lock_auth_base *auth, bool read);
+  count_type unlock_exclusive();
+
+  void queue_push(queued_waiter *waiter);
+  void queue_remove(queued_waiter *waiter);
+
+  void record_lock(bool read, bool waited);
+  void start_hold();
+  void end_hold();
+  void choose_mode();
+  void switch_mode();
+
+  mode_type                  mode, next_mode;
+  const count_type           window;
+  count_type                 readers, readers_waiting, writers_waiting;
+  bool                       writer, writer_waiting;
+  const void                *the_writer;
+  std::atomic <bool>         busy;
+  queued_waiter             *queue_head, *queue_tail;
+  count_type                 reads, writes, contended, switches, hold_samples;
+  unsigned long              hold_ns;
+  bool                       sampling;
+  clock_type::time_point     hold_start;
+  mutable std::mutex         master_lock;
+  std::condition_variable    read_wait, write_wait;
+};
+
+
+/*! \class priority_lock
+ *  \brief Lock object that grants locks to higher-priority threads first.
+ *
+ * This lock has the same sharing rules as rw_lock, but waiting threads are
+ * granted the lock in order of priority, and in arrival order within the same
+ * priority. (A waiting reader only waits for writers that are ahead of it.) The
+ * priority is set per thread with set_thread_priority; larger values are more
+ * urgent. While a thread is waiting, the threads holding the lock inherit its
+ * priority if it's higher than theirs, which means that they are also treated as
+ * more urgent when they wait for other priority_lock objects. Inheritance only
+ * goes one level deep: a boost is recalculated when the holders or waiters of
+ * the boosting lock change. Waiters are kept in priority order, so an unlock
+ * only looks at (and wakes) the waiters that can lock next; if a waiting
+ * thread's priority changes, the order is updated before the next waiter is
+ * chosen.
+ * \attention The thread that unlocks must be the thread that locked.
+ */
+
+class priority_lock : public lock_base {
+public:
+  using lock_base::count_type;
+  typedef int priority_type;
+
+  priority_lock();
+
+private:
+  priority_lock(const priority_lock&);
+  priority_lock &operator = (const priority_lock&);
+
+public:
+  count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false);
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false);
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false);
+
+  /*! Set the base priority of the calling thread.*/
+  static void set_thread_priority(priority_type priority);
+
+  /*! Get the calling thread's priority, including inherited priority.*/
+  static priority_type get_thread_priority();
+
+  ~priority_lock();
+
+private:
+  class thread_priority {
+  public:
+    thread_priority();
+
+    priority_type get_priority() const;
+    void set_base(priority_type priority);
+    void set_inherited(const priority_lock *from, priority_type priority);
+
+    //(the lock that the thread is waiting for, if any)
+    void set_waiting(priority_lock *lock);
+
+  private:
+    void update();
+
+    typedef std::map <const priority_lock*, priority_type> inherited_map;
+
+    priority_type                 base;
+    std::atomic <priority_type>   current;
+    std::mutex                    inherit_lock;
+    inherited_map                 inherited;
+    priority_lock                *waiting;
+  };
+
+  struct waiter {
+    thread_priority         *thread;
+    bool                     read;
+    unsigned long            arrival;
+    //(the thread's priority when the waiters were last ordered)
+    priority_type            priority;
+    //(only this waiter is woken when it's next)
+    std::condition_variable *wake;
+  };
+
+  //(higher priority first, then earlier arrival)
+  struct waiter_order {
+    bool operator () (const waiter *left, const waiter *right) const;
+  };
+
+  typedef std::set <waiter*, waiter_order> waiter_set;
+  typedef std::vector <thread_priority*>   holder_list;
+
+  static thread_priority &current_thread();
+
+  count_type lock_common(std::unique_lock <std::mutex> &local_lock, lock_auth_base *auth,
+    bool read, bool block, bool test, const cancel_token *cancel,
+    std::condition_variable &wake);
+
+  void add_waiter(waiter *current);
+  void remove_waiter(waiter *current);
+  void reorder_waiters();
+  bool can_lock(const waiter *current) const;
+  void wake_next(const waiter *skip = NULL);
+  void update_inherited();
+  void remove_holder(thread_priority *thread);
+
+  count_type              readers;
+  bool                    writer;
+  const void             *the_writer;
+  unsigned long           arrivals;
+  //(all waiters, and just the writers, in the order that they'll be granted)
+  waiter_set              waiters, waiting_writers;
+  holder_list             holders;
+  //(set when a waiting thread's priority changes)
+  std::atomic <bool>      reordered;
+  std::mutex              master_lock;
+};
+
+
 /*! \class broken_lock
  *  \brief Lock object that is permanently broken.
  *
@@ -0,0 +1,133 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides an output sink for logging from multiple threads. Rather
+ * than protecting a 'FILE*' with a lock (which means that every thread waits
+ * while another thread formats and writes), each thread formats its message
+ * into a thread-local buffer and appends it to a lock-free queue. A background
+ * thread writes whatever has been queued with a single 'writev' call.
+ *
+ * This requires POSIX (for 'writev').
+ */
+
+#ifndef lc_log_sink_hpp
+#define lc_log_sink_hpp
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lc {
+
+
+/*! \class log_sink
+ *  \brief Asynchronous, batched output for messages from multiple threads.
+ *
+ * Messages are stored in a fixed number of fixed-size slots. A message that's
+ * too long for a slot is truncated. If all of the slots are in use, the caller
+ * yields until the background thread frees some. Messages from one thread are
+ * always written in the order they were queued.
+ */
+
+class log_sink {
+public:
+  /*! \brief Constructor.
+   *
+   * \param new_fd file descriptor to write to (not closed by this object)
+   * \param slot_count number of slots (rounded up to a power of 2)
+   * \param new_slot_size maximum length of a message, plus one
+   */
+  explicit log_sink(int new_fd, size_t slot_count = 1024, size_t new_slot_size = 256);
+
+private:
+  log_sink(const log_sink&);
+  log_sink &operator = (const log_sink&);
+
+public:
+  /*! Queue a formatted message. Returns the same as 'printf'.*/
+  int printf(const char *format, ...);
+
+  /*! Queue a formatted message. Returns the same as 'vprintf'.*/
+  int vprintf(const char *format, va_list ap);
+
+  /*! Wait until all messages queued so far have been written.*/
+  void flush();
+
+  /*! Flushes everything that has been queued.*/
+  ~log_sink();
+
+private:
+  struct slot {
+    std::atomic <size_t> sequence;
+    size_t               length;
+  };
+
+  static size_t round_up(size_t count);
+
+  void append(const char *message, size_t length);
+  void wake_flusher();
+  void run_flusher();
+  size_t write_ready();
+  void write_all(struct iovec *vectors, size_t count);
+
+  const int                    fd;
+  const size_t                 slot_size, mask;
+  std::unique_ptr <slot[]>     slots;
+  std::vector <char>           data;
+  std::atomic <size_t>         tail, written;
+  size_t                       head;
+  std::atomic <bool>           sleeping;
+  std::atomic <unsigned int>   flushing;
+  bool                         stopping;
+  std::mutex                   flusher_lock;
+  std::condition_variable      flusher_wait, flushed_wait;
+  std::thread                  flusher;
+};
+
+} //namespace lc
+
+#endif //lc_log_sink_hpp
@@ -56,26 +56,43 @@ public:
   virtual write_proxy get_write_auth(auth_type &authorization, bool block = true);
   virtual read_proxy  get_read_auth(auth_type &authorization,  bool block = true);
 
+  /*! Block for the lock, unless 'cancel' is cancelled while waiting.*/
+  virtual write_proxy get_write_auth(auth_type &authorization, const cancel_token &cancel);
+  /*! Block for the lock, unless 'cancel' is cancelled while waiting.*/
+  virtual read_proxy  get_read_auth(auth_type &authorization,  const cancel_token &cancel);
+
   virtual inline ~meta_lock_base() {}
 
 protected:
   virtual write_proxy get_write_auth(lock_auth_base *authorization, bool block = true) = 0;
   virtual read_proxy  get_read_auth(lock_auth_base *authorization,  bool block = true) = 0;
 
+  /*! Block for the lock, unless 'cancel' is cancelled. The default only checks
+   *  'cancel' before blocking.*/
+  virtual write_proxy get_write_cancel(lock_auth_base *authorization, const cancel_token &cancel);
+  /*! Block for the lock, unless 'cancel' is cancelled. The default only checks
+   *  'cancel' before blocking.*/
+  virtual read_proxy  get_read_cancel(lock_auth_base *authorization,  const cancel_token &cancel);
+
 private:
   template <class> friend class locking_container_base;
+  template <class> friend class lock_table;
 
   virtual lock_base *get_lock_object() = 0;
 };
 
 
-/*! \class meta_lock
+/*! \class basic_meta_lock
  *  \brief Empty container, used as a global meta-locking mechanism.
+ *
+ * The lock type can be changed, e.g., to instrument the multi-lock; it should
+ * behave like \ref rw_lock. Most code should just use \ref meta_lock.
  */
 
-class meta_lock : public meta_lock_base {
+template <class Lock = rw_lock>
+class basic_meta_lock : public meta_lock_base {
 private:
-  typedef lock_auth <rw_lock> auth_base_type;
+  typedef lock_auth <Lock> auth_base_type;
 
 public:
   typedef meta_lock_base base;
@@ -83,12 +100,18 @@ public:
   using base::read_proxy;
   using base::auth_type;
   using base::get_write_auth;
+  using base::get_read_auth;
 
-  inline meta_lock() {}
+  inline basic_meta_lock() {}
+
+  /*! Get the multi-lock's lock, e.g., to read statistics from it.*/
+  const Lock &get_lock() const {
+    return locks;
+  }
 
 private:
-  meta_lock(const meta_lock&);
-  meta_lock &operator = (const meta_lock&);
+  basic_meta_lock(const basic_meta_lock&);
+  basic_meta_lock &operator = (const basic_meta_lock&);
 
   inline write_proxy get_write_auth(lock_auth_base *authorization, bool block = true) {
     return write_proxy(true, &locks, authorization, false, block, NULL);
@@ -98,11 +121,33 @@ private:
     return read_proxy(true, &locks, authorization, true, block, NULL);
   }
 
+  inline write_proxy get_write_cancel(lock_auth_base *authorization, const cancel_token &cancel) {
+    return write_proxy(true, &locks, authorization, false, true, NULL, &cancel);
+  }
+
+  inline read_proxy get_read_cancel(lock_auth_base *authorization, const cancel_token &cancel) {
+    return read_proxy(true, &locks, authorization, true, true, NULL, &cancel);
+  }
+
   inline lock_base *get_lock_object() {
     return &locks;
   }
 
-  rw_lock locks;
+  Lock locks;
+};
+
+
+/*! \class meta_lock
+ *  \brief Empty container, used as a global meta-locking mechanism.
+ */
+
+class meta_lock : public basic_meta_lock <> {
+public:
+  inline meta_lock() {}
+
+private:
+  meta_lock(const meta_lock&);
+  meta_lock &operator = (const meta_lock&);
 };
 
 } //namespace lc
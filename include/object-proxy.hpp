@@ -50,8 +50,8 @@ public:
   object_proxy_base() {}
 
   object_proxy_base(Type *new_pointer, lock_base *new_locks, lock_auth_base *new_auth,
-    bool new_read, bool block, lock_base *new_multi) :
-    container_lock(new locker(new_pointer, new_locks, new_auth, new_read, block, new_multi)) {}
+    bool new_read, bool block, lock_base *new_multi, const cancel_token *cancel = NULL) :
+    container_lock(new locker(new_pointer, new_locks, new_auth, new_read, block, new_multi, cancel)) {}
 
   inline int last_lock_count() const {
     //(mostly provided for debugging)
@@ -77,12 +77,12 @@ private:
     locker() : pointer(NULL), lock_count(), read(true), locks(NULL), multi(NULL), auth() {}
 
     locker(Type *new_pointer, lock_base *new_locks, lock_auth_base *new_auth,
-      bool new_read, bool block, lock_base *new_multi) :
+      bool new_read, bool block, lock_base *new_multi, const cancel_token *cancel) :
       pointer(new_pointer), lock_count(), read(new_read), locks(new_locks), multi(new_multi), auth(new_auth) {
       //attempt to lock the multi-lock if there is one (not counted toward 'auth')
-      if (multi && multi->lock(auth, true, block, true) < 0) this->opt_out(false, false);
+      if (multi && lock_object(multi, auth, true, block, true, cancel) < 0) this->opt_out(false, false);
       //attempt to lock the container's lock
-      if (!locks || (lock_count = locks->lock(auth, read, block)) < 0) this->opt_out(false);
+      if (!locks || (lock_count = lock_object(locks, auth, read, block, false, cancel)) < 0) this->opt_out(false);
     }
 
     int last_lock_count() const {
@@ -115,6 +115,13 @@ private:
     locker(const locker&);
     locker &operator = (const locker&);
 
+    static inline int lock_object(lock_base *object, lock_auth_base *auth, bool read,
+      bool block, bool test, const cancel_token *cancel) {
+      //(a token only matters if the call would otherwise block)
+      return (block && cancel)? object->lock_cancel(auth, read, *cancel, test) :
+                                object->lock(auth, read, block, test);
+    }
+
     bool             read;
     lock_base       *locks, *multi;
     lock_auth_base  *auth;
@@ -138,10 +145,12 @@ template <class Type>
 class object_proxy : public object_proxy_base <Type> {
 private:
   template <class, class> friend class locking_container;
+  template <class> friend class lock_table;
+  template <class, class> friend class protected_array;
 
   object_proxy(Type *new_pointer, lock_base *new_locks, lock_auth_base *new_auth,
-    bool read, bool block, lock_base *new_multi) :
-    object_proxy_base <Type> (new_pointer, new_locks, new_auth, read, block, new_multi) {}
+    bool read, bool block, lock_base *new_multi, const cancel_token *cancel = NULL) :
+    object_proxy_base <Type> (new_pointer, new_locks, new_auth, read, block, new_multi, cancel) {}
 
 public:
   object_proxy() : object_proxy_base <Type> () {}
@@ -235,10 +244,12 @@ template <class Type>
 class object_proxy <const Type> : public object_proxy_base <const Type> {
 private:
   template <class, class> friend class locking_container;
+  template <class> friend class lock_table;
+  template <class, class> friend class protected_array;
 
   object_proxy(const Type *new_pointer, lock_base *new_locks, lock_auth_base *new_auth,
-    bool read, bool block, lock_base *new_multi) :
-    object_proxy_base <const Type> (new_pointer, new_locks, new_auth, read, block, new_multi) {}
+    bool read, bool block, lock_base *new_multi, const cancel_token *cancel = NULL) :
+    object_proxy_base <const Type> (new_pointer, new_locks, new_auth, read, block, new_multi, cancel) {}
 
 public:
   object_proxy() : object_proxy_base <const Type> () {}
@@ -332,10 +343,12 @@ class object_proxy <void> : public object_proxy_base <void> {
 private:
   friend class meta_lock_write_proxy;
   friend class meta_lock_read_proxy;
+  //(needed for the inherited constructors of the classes above)
+  template <class> friend class basic_meta_lock;
 
   object_proxy(bool value, lock_base *new_locks, lock_auth_base *new_auth,
-    bool read, bool block, lock_base *new_multi) :
-    object_proxy_base <void> ((void*) value, new_locks, new_auth, read, block, new_multi) {}
+    bool read, bool block, lock_base *new_multi, const cancel_token *cancel = NULL) :
+    object_proxy_base <void> ((void*) value, new_locks, new_auth, read, block, new_multi, cancel) {}
 
 public:
   object_proxy() : object_proxy_base <void> () {}
@@ -356,13 +369,13 @@ public:
 
 
 class meta_lock_write_proxy : public object_proxy <void> {
-  friend class meta_lock;
+  template <class> friend class basic_meta_lock;
   using object_proxy <void> ::object_proxy;
 };
 
 
 class meta_lock_read_proxy : public object_proxy <void> {
-  friend class meta_lock;
+  template <class> friend class basic_meta_lock;
   using object_proxy <void> ::object_proxy;
 };
 
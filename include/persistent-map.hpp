@@ -0,0 +1,495 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a map for data that's read much more often than it's
+ * written, where readers want a consistent view of the whole map. The map is a
+ * hash array mapped trie (HAMT) made of immutable nodes, so a writer copies
+ * only the nodes on the path to the key it changes (about log32(n) of them),
+ * and the rest are shared with the previous version. Readers take a snapshot
+ * (a pointer to the current version) without using the map's lock, and the
+ * snapshot never changes, no matter what writers do afterward.
+ */
+
+#ifndef lc_persistent_map_hpp
+#define lc_persistent_map_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class persistent_map
+ *  \brief Map with O(1) snapshots and path-copying writes.
+ *
+ * Writers are serialized by a \ref locking_container (using Lock), so the
+ * usual accessor variants with auth. objects are available. Each write creates
+ * a new version of the map and publishes it with 'std::atomic_store', and
+ * get_snapshot gets the current version with 'std::atomic_load'. Neither of
+ * those uses the container's lock, so readers never wait for writers to
+ * finish building a version.
+ * \attention The atomic 'std::shared_ptr' functions usually aren't lock-free
+ * (e.g., libstdc++ uses a small global table of spinlocks, selected by the
+ * pointer's address and shared by every atomic 'std::shared_ptr' operation in
+ * the process). A snapshot therefore still takes a brief global lock, just not
+ * the map's lock. Take a snapshot once and then read from it, rather than
+ * taking a snapshot for every lookup.
+ *
+ * modify allows several changes to be published as a single version, e.g.:
+ *
+ *   my_map.modify([](lc::persistent_map <int, int> ::editor &edit) {
+ *       edit.set(1, 10);
+ *       edit.erase(2);
+ *     });
+ * \attention Old versions are freed when the last snapshot of them is
+ * destroyed, so long-lived snapshots keep their nodes alive.
+ */
+
+template <class Key, class Value, class Lock = w_lock, class Hash = std::hash <Key> >
+class persistent_map {
+private:
+  struct node;
+  struct version;
+
+  typedef std::shared_ptr <const node>    node_pointer;
+  typedef std::shared_ptr <const version> version_pointer;
+
+public:
+  typedef Key                       key_type;
+  typedef Value                     mapped_type;
+  typedef lock_auth_base::auth_type auth_type;
+
+  /*! \class snapshot
+   *  \brief Immutable view of one version of the map.
+   */
+
+  class snapshot {
+  public:
+    snapshot() : current(new version) {}
+
+    /*! \brief Find the value for 'key'.
+     *
+     * \return pointer to the value (valid while this snapshot exists), or NULL
+     */
+    const Value *find(const Key &key) const {
+      return persistent_map::find_value(current->root.get(), Hash()(key), key);
+    }
+
+    /*! \brief Copy the value for 'key' into 'value'.
+     *
+     * \return true if 'key' was found
+     */
+    bool get(const Key &key, Value &value) const {
+      const Value *found = this->find(key);
+      if (found) value = *found;
+      return found;
+    }
+
+    size_t size() const {
+      return current->size;
+    }
+
+    /*! Call 'func' with each key and value.*/
+    template <class Func>
+    void for_each(Func func) const {
+      persistent_map::visit(current->root.get(), func);
+    }
+
+  private:
+    friend class persistent_map;
+
+    explicit snapshot(const version_pointer &new_current) : current(new_current) {}
+
+    version_pointer current;
+  };
+
+  /*! \class editor
+   *  \brief Changes to be published as a single version.
+   *
+   * @see modify
+   */
+
+  class editor {
+  public:
+    const Value *find(const Key &key) const {
+      return persistent_map::find_value(root.get(), Hash()(key), key);
+    }
+
+    bool get(const Key &key, Value &value) const {
+      const Value *found = this->find(key);
+      if (found) value = *found;
+      return found;
+    }
+
+    /*! Set the value for 'key', adding it if necessary.*/
+    void set(const Key &key, const Value &value) {
+      bool added = false;
+      root = persistent_map::insert(root, 0, Hash()(key), key, value, added);
+      if (added) ++count;
+    }
+
+    /*! \brief Remove 'key'.
+     *
+     * \return true if 'key' was found
+     */
+    bool erase(const Key &key) {
+      bool removed = false;
+      root = persistent_map::remove(root, 0, Hash()(key), key, removed);
+      if (removed) --count;
+      return removed;
+    }
+
+    size_t size() const {
+      return count;
+    }
+
+  private:
+    friend class persistent_map;
+
+    editor(const node_pointer &new_root, size_t new_count) : root(new_root), count(new_count) {}
+
+    editor(const editor&);
+    editor &operator = (const editor&);
+
+    node_pointer root;
+    size_t       count;
+  };
+
+  /*! \brief Constructor.
+   *
+   * \param args arguments to pass to the lock's constructor.
+   */
+  template <class ... Types>
+  explicit persistent_map(Types ... args) :
+    published(new version), writer(published, args...) {}
+
+private:
+  persistent_map(const persistent_map&);
+  persistent_map &operator = (const persistent_map&);
+
+public:
+  /** @name Readers
+   *
+   */
+  //@{
+
+  /*! Get the current version of the map. This never uses the map's lock.*/
+  snapshot get_snapshot() const {
+    return snapshot(std::atomic_load(&published));
+  }
+
+  bool get(const Key &key, Value &value) const {
+    return this->get_snapshot().get(key, value);
+  }
+
+  size_t size() const {
+    return this->get_snapshot().size();
+  }
+
+  //@}
+
+  /** @name Writers
+   *
+   */
+  //@{
+
+  /*! \brief Apply all of the changes made by 'func' as a single version.
+   *
+   * 'func' is called with an \ref editor while the map is locked for writing.
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  template <class Func>
+  bool modify(Func func) {
+    return this->modify_common(func, writer.get_write());
+  }
+
+  template <class Func>
+  bool modify(Func func, auth_type &auth) {
+    return this->modify_common(func, writer.get_write_auth(auth));
+  }
+
+  /*! \brief Set the value for 'key', adding it if necessary.
+   *
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  bool set(const Key &key, const Value &value) {
+    return this->modify(set_function(key, value));
+  }
+
+  bool set(const Key &key, const Value &value, auth_type &auth) {
+    return this->modify(set_function(key, value), auth);
+  }
+
+  /*! \brief Remove 'key'.
+   *
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  bool erase(const Key &key) {
+    return this->modify(erase_function(key));
+  }
+
+  bool erase(const Key &key, auth_type &auth) {
+    return this->modify(erase_function(key), auth);
+  }
+
+  //@}
+
+  /** @name Authorization
+   *
+   */
+  //@{
+
+  /*! Get a new authorization object.*/
+  auth_type get_new_auth() const {
+    return writer.get_new_auth();
+  }
+
+  /*! Get a new authorization object.*/
+  static auth_type new_auth() {
+    return locking_container <version_pointer, Lock> ::new_auth();
+  }
+
+  //@}
+
+private:
+  //NOTE: each level of the trie uses this many bits of the hash
+  enum { level_bits = 5, level_mask = (1 << level_bits) - 1 };
+
+  struct node {
+    node() : bitmap(0), hash(0) {}
+
+    //(a node with entries is a leaf; otherwise, it's a branch)
+    bool is_leaf() const {
+      return !entries.empty();
+    }
+
+    //(branch: which of the 32 slots are used, and their nodes, in slot order)
+    uint32_t                  bitmap;
+    std::vector <node_pointer> children;
+    //(leaf: the entries whose keys all have this full hash)
+    size_t                                hash;
+    std::vector <std::pair <Key, Value> > entries;
+  };
+
+  struct version {
+    version() : size(0) {}
+
+    node_pointer root;
+    size_t       size;
+  };
+
+  struct set_function {
+    set_function(const Key &new_key, const Value &new_value) : key(new_key), value(new_value) {}
+
+    void operator () (editor &edit) const {
+      edit.set(key, value);
+    }
+
+    const Key   &key;
+    const Value &value;
+  };
+
+  struct erase_function {
+    explicit erase_function(const Key &new_key) : key(new_key) {}
+
+    void operator () (editor &edit) const {
+      edit.erase(key);
+    }
+
+    const Key &key;
+  };
+
+  template <class Func>
+  bool modify_common(Func &func,
+    typename locking_container <version_pointer, Lock> ::write_proxy write) {
+    if (!write) return false;
+    editor edit((*write)->root, (*write)->size);
+    func(edit);
+    if (edit.root == (*write)->root) return true;
+    std::shared_ptr <version> next(new version);
+    next->root = edit.root;
+    next->size = edit.count;
+    *write = next;
+    std::atomic_store(&published, *write);
+    return true;
+  }
+
+  static unsigned int get_slot(size_t hash, unsigned int shift) {
+    //(hashes only run out of bits if they're equal, in which case it's a leaf)
+    return (shift < sizeof hash * 8)? (hash >> shift) & level_mask : 0;
+  }
+
+  static unsigned int get_index(uint32_t bitmap, unsigned int slot) {
+    uint32_t lower = bitmap & (((uint32_t) 1 << slot) - 1);
+    unsigned int count = 0;
+    for (; lower; lower &= lower - 1) ++count;
+    return count;
+  }
+
+  static node_pointer new_leaf(size_t hash, const Key &key, const Value &value) {
+    std::shared_ptr <node> leaf(new node);
+    leaf->hash = hash;
+    leaf->entries.push_back(std::make_pair(key, value));
+    return leaf;
+  }
+
+  static const Value *find_value(const node *current, size_t hash, const Key &key) {
+    for (unsigned int shift = 0; current; shift += level_bits) {
+      if (current->is_leaf()) {
+        if (current->hash != hash) return NULL;
+        for (size_t i = 0; i < current->entries.size(); i++) {
+          if (current->entries[i].first == key) return &current->entries[i].second;
+        }
+        return NULL;
+      }
+      const unsigned int slot = get_slot(hash, shift);
+      if (!(current->bitmap & ((uint32_t) 1 << slot))) return NULL;
+      current = current->children[get_index(current->bitmap, slot)].get();
+    }
+    return NULL;
+  }
+
+  static node_pointer insert(const node_pointer &current, unsigned int shift, size_t hash,
+    const Key &key, const Value &value, bool &added) {
+    if (!current) {
+      added = true;
+      return new_leaf(hash, key, value);
+    }
+
+    if (current->is_leaf()) {
+      if (current->hash == hash) {
+        std::shared_ptr <node> copy(new node(*current));
+        for (size_t i = 0; i < copy->entries.size(); i++) {
+          if (copy->entries[i].first == key) {
+            copy->entries[i].second = value;
+            return copy;
+          }
+        }
+        added = true;
+        copy->entries.push_back(std::make_pair(key, value));
+        return copy;
+      }
+      //(the hashes differ, so push the leaf down into a new branch)
+      std::shared_ptr <node> branch(new node);
+      branch->bitmap = (uint32_t) 1 << get_slot(current->hash, shift);
+      branch->children.push_back(current);
+      return insert(branch, shift, hash, key, value, added);
+    }
+
+    const unsigned int slot  = get_slot(hash, shift);
+    const unsigned int index = get_index(current->bitmap, slot);
+    std::shared_ptr <node> copy(new node(*current));
+    if (current->bitmap & ((uint32_t) 1 << slot)) {
+      copy->children[index] = insert(current->children[index], shift + level_bits, hash,
+        key, value, added);
+    } else {
+      added = true;
+      copy->bitmap |= (uint32_t) 1 << slot;
+      copy->children.insert(copy->children.begin() + index, new_leaf(hash, key, value));
+    }
+    return copy;
+  }
+
+  static node_pointer remove(const node_pointer &current, unsigned int shift, size_t hash,
+    const Key &key, bool &removed) {
+    if (!current) return current;
+
+    if (current->is_leaf()) {
+      if (current->hash != hash) return current;
+      for (size_t i = 0; i < current->entries.size(); i++) {
+        if (current->entries[i].first == key) {
+          removed = true;
+          if (current->entries.size() == 1) return node_pointer();
+          std::shared_ptr <node> copy(new node(*current));
+          copy->entries.erase(copy->entries.begin() + i);
+          return copy;
+        }
+      }
+      return current;
+    }
+
+    const unsigned int slot = get_slot(hash, shift);
+    if (!(current->bitmap & ((uint32_t) 1 << slot))) return current;
+    const unsigned int index = get_index(current->bitmap, slot);
+    node_pointer child = remove(current->children[index], shift + level_bits, hash, key, removed);
+    if (!removed) return current;
+
+    //NOTE: a branch left with a single leaf is replaced by the leaf, so that
+    //leaves are always as close to the root as possible
+    if (child && child->is_leaf() && current->children.size() == 1) return child;
+    std::shared_ptr <node> copy(new node(*current));
+    if (child) {
+      copy->children[index] = child;
+    } else {
+      copy->bitmap &= ~((uint32_t) 1 << slot);
+      copy->children.erase(copy->children.begin() + index);
+      if (copy->children.empty()) return node_pointer();
+      if (copy->children.size() == 1 && copy->children[0]->is_leaf()) return copy->children[0];
+    }
+    return copy;
+  }
+
+  template <class Func>
+  static void visit(const node *current, Func &func) {
+    if (!current) return;
+    if (current->is_leaf()) {
+      for (size_t i = 0; i < current->entries.size(); i++) {
+        func(current->entries[i].first, current->entries[i].second);
+      }
+    } else {
+      for (size_t i = 0; i < current->children.size(); i++) {
+        visit(current->children[i].get(), func);
+      }
+    }
+  }
+
+  //(the current version, for readers)
+  version_pointer published;
+  //(also the current version, but only changed while locked)
+  locking_container <version_pointer, Lock> writer;
+};
+
+} //namespace lc
+
+#endif //lc_persistent_map_hpp
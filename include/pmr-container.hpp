@@ -0,0 +1,166 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a container whose contents allocate memory from a memory
+ * resource that belongs to the container. Since writers already have exclusive
+ * access to the contents, the resource doesn't need to be thread-safe. The
+ * resource still gets its memory from its upstream resource (the global
+ * allocator, by default), but it does so in large chunks, which amortizes the
+ * cost of (and the contention for) the global allocator over many allocations
+ * made while holding a write lock.
+ *
+ * This requires C++17 (for 'std::pmr'); otherwise, this file is empty.
+ */
+
+#ifndef lc_pmr_container_hpp
+#define lc_pmr_container_hpp
+
+#if __cplusplus >= 201703L
+
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class pmr_container_resource
+ *  \brief Holds the memory resource for \ref pmr_container.
+ *
+ * This is a separate base class so that the resource is created before the
+ * contained object and destroyed after it. The resource is default-constructed,
+ * which means that it uses 'std::pmr::get_default_resource()' as its upstream.
+ */
+
+template <class Resource>
+class pmr_container_resource {
+protected:
+  pmr_container_resource() : resource(new Resource) {}
+
+  std::unique_ptr <Resource> resource;
+};
+
+
+/*! \class pmr_container
+ *  \brief Container that allocates from its own memory resource.
+ *
+ * This is a \ref locking_container whose contained object (which must be an
+ * allocator-aware 'std::pmr' type, e.g., 'std::pmr::map') is constructed with
+ * a Resource (third template argument) that belongs to the container.
+ * Everything allocated by the object, including elements added while holding a
+ * write proxy, comes from that resource. The resource gets chunks of memory
+ * from its upstream resource ('std::pmr::new_delete_resource()' by default) as
+ * it needs them, so the global allocator is still used occasionally, but not
+ * for every allocation. To avoid it entirely, use a Resource type whose
+ * default constructor passes it a preallocated buffer or another upstream.
+ *
+ * The default Resource is 'std::pmr::unsynchronized_pool_resource', which
+ * reuses freed memory. With 'std::pmr::monotonic_buffer_resource', freed memory
+ * isn't reused until compact is called. compact copies the contents into a
+ * new resource and then frees the old resource all at once, which is also
+ * useful with a pool resource after many elements have been removed.
+ * \attention The resource isn't thread-safe. This is fine for writers, but
+ * readers must not allocate with the object's allocator, e.g., by calling a
+ * 'const' function that does so. (Copying elements uses the default allocator.)
+ */
+
+template <class Type, class Lock = rw_lock,
+  class Resource = std::pmr::unsynchronized_pool_resource>
+class pmr_container : private pmr_container_resource <Resource>,
+                      public locking_container <Type, Lock> {
+private:
+  typedef locking_container <Type, Lock> base;
+
+public:
+  using typename base::type;
+  using typename base::write_proxy;
+  using typename base::auth_type;
+  typedef typename Type::allocator_type allocator_type;
+
+  /*! \brief Constructor.
+   *
+   * \param args arguments to pass to the lock's constructor.
+   */
+  template <class ... Types>
+  explicit pmr_container(Types ... args) :
+    base(Type(allocator_type(this->resource.get())), args...) {}
+
+private:
+  pmr_container(const pmr_container&);
+  pmr_container &operator = (const pmr_container&);
+
+public:
+  /*! \brief Move the contents to a new resource, and free the old one.
+   *
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  bool compact() {
+    write_proxy write = this->get_write();
+    return this->compact_common(write);
+  }
+
+  bool compact(auth_type &auth) {
+    write_proxy write = this->get_write_auth(auth);
+    return this->compact_common(write);
+  }
+
+private:
+  bool compact_common(write_proxy &write) {
+    if (!write) return false;
+    std::unique_ptr <Resource> fresh(new Resource);
+    Type *const object = &*write;
+    {
+      Type copy(*object, allocator_type(fresh.get()));
+      //NOTE: assignment would keep the old allocator, so the object is
+      //replaced instead; moving it keeps the new one
+      object->~Type();
+      new (object) Type(std::move(copy));
+    }
+    //(the old resource is freed when 'fresh' goes out of scope)
+    this->resource.swap(fresh);
+    return true;
+  }
+};
+
+} //namespace lc
+
+#endif //__cplusplus >= 201703L
+
+#endif //lc_pmr_container_hpp
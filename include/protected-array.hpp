@@ -0,0 +1,373 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides an array of small values (e.g., sensor readings) that are
+ * protected individually, without a lock per value. The values are stored
+ * contiguously, and each block of consecutive values shares a lock, with the
+ * locks packed into a separate array. Single values are accessed via the same
+ * proxies used by 'locking_container', and ranges of values can be read
+ * consistently by locking all of the blocks in the range at once, which also
+ * means that a reduction over the range sees a single contiguous array.
+ */
+
+#ifndef lc_protected_array_hpp
+#define lc_protected_array_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "lock-table.hpp"
+#include "object-proxy.hpp"
+
+namespace lc {
+
+
+/*! \class protected_array
+ *  \brief Fixed-size array of values protected by block locks.
+ *
+ * get_write and get_read lock the block containing the element, so locking
+ * two elements in the same block is the same as locking one container twice
+ * (see same_block). The range functions read-lock every block in the range,
+ * in order of index, before they look at any of the values; if the lock type
+ * is \ref ordered_lock, each block gets its own order, starting at the order
+ * passed to the constructor, so this follows the ordered-lock rules.
+ *
+ * read_range calls a function with a pointer to the values in the range, which
+ * are contiguous, so that it can use a vectorized loop. sum is an example of
+ * this.
+ *
+ * The values start on a cache line, and the block size is rounded up so that
+ * every block also starts on a cache line, which means that writes to values
+ * in neighboring blocks don't touch the same line. The locks are kept together
+ * in a single array (not allocated individually), so that locking a range
+ * touches as few cache lines as possible; this means that neighboring blocks'
+ * locks can share a line.
+ * \attention Lock types are created with lock_table_factory::construct (see
+ * \ref lock_table_factory).
+ */
+
+template <class Type, class Lock = rw_lock>
+class protected_array {
+private:
+  typedef lock_auth <Lock> auth_base_type;
+
+public:
+  typedef Type                       type;
+  typedef Lock                       lock_type;
+  typedef object_proxy <type>        write_proxy;
+  typedef object_proxy <const type>  read_proxy;
+  typedef lock_auth_base::auth_type  auth_type;
+  typedef lock_auth_base::order_type order_type;
+
+  /*! \brief Constructor.
+   *
+   * \param size number of elements.
+   * \param value initial value of each element.
+   * \param new_block_size number of elements per lock (rounded up to fill
+   * whole cache lines; see get_block_size).
+   * \param first_order order of the first block (ordered locks only).
+   */
+  explicit protected_array(size_t size, const Type &value = Type(), size_t new_block_size = 64,
+    order_type first_order = 1) :
+    block_size(protected_array::aligned_block_size(new_block_size)), values(size),
+    locks((size + block_size - 1) / block_size) {
+    for (size_t i = 0; i < values.capacity(); i++) {
+      new (values.next_slot()) Type(value);
+      values.added();
+    }
+    for (size_t i = 0; i < locks.capacity(); i++) {
+      lock_table_factory <Lock> ::construct(locks.next_slot(), first_order + i);
+      locks.added();
+    }
+  }
+
+private:
+  protected_array(const protected_array&);
+  protected_array &operator = (const protected_array&);
+
+public:
+  /** @name Accessor Functions
+   *
+   */
+  //@{
+
+  /*! \brief Retrieve a writable proxy to element 'index'.
+   *
+   * @see locking_container_base::get_write
+   * \param index index of the element
+   * \param block Should the call block for a lock?
+   *
+   * \return proxy object
+   */
+  inline write_proxy get_write(size_t index, bool block = true) {
+    return this->get_write_common(index, NULL, block);
+  }
+
+  /*! \brief Retrieve a read-only proxy to element 'index'.
+   *
+   * @see locking_container_base::get_read
+   */
+  inline read_proxy get_read(size_t index, bool block = true) const {
+    return this->get_read_common(index, NULL, block);
+  }
+
+  /*! \brief Retrieve a writable proxy to element 'index' using deadlock
+   *  prevention.
+   *
+   * @see locking_container_base::get_write_auth
+   */
+  inline write_proxy get_write_auth(size_t index, auth_type &auth, bool block = true) {
+    if (!auth) return write_proxy();
+    return this->get_write_common(index, auth.get(), block);
+  }
+
+  /*! \brief Retrieve a read-only proxy to element 'index' using deadlock
+   *  prevention.
+   *
+   * @see locking_container_base::get_read_auth
+   */
+  inline read_proxy get_read_auth(size_t index, auth_type &auth, bool block = true) const {
+    if (!auth) return read_proxy();
+    return this->get_read_common(index, auth.get(), block);
+  }
+
+  //@}
+
+  /** @name Range Functions
+   *
+   */
+  //@{
+
+  /*! \brief Call 'func' with a consistent view of elements 'begin' to 'end - 1'.
+   *
+   * 'func' is called as 'func(const Type *values, size_t count)' while all of
+   * the blocks in the range are read-locked.
+   * \return success or failure (i.e., a lock was rejected, or the range isn't
+   * within the array)
+   */
+  template <class Func>
+  bool read_range(size_t begin, size_t end, Func func) const {
+    return this->read_range_common(begin, end, func, NULL);
+  }
+
+  template <class Func>
+  bool read_range(size_t begin, size_t end, Func func, auth_type &auth) const {
+    if (!auth) return false;
+    return this->read_range_common(begin, end, func, auth.get());
+  }
+
+  /*! \brief Copy elements 'begin' to 'end - 1' into 'output' consistently.
+   *
+   * \return success or failure (i.e., a lock was rejected, or the range isn't
+   * within the array, in which case nothing is copied)
+   */
+  bool copy_range(size_t begin, size_t end, Type *output) const {
+    return this->read_range(begin, end, copy_function(output));
+  }
+
+  bool copy_range(size_t begin, size_t end, Type *output, auth_type &auth) const {
+    return this->read_range(begin, end, copy_function(output), auth);
+  }
+
+  /*! \brief Add up elements 'begin' to 'end - 1' consistently.
+   *
+   * \return success or failure (i.e., a lock was rejected, or the range isn't
+   * within the array)
+   */
+  bool sum(size_t begin, size_t end, Type &result) const {
+    return this->read_range(begin, end, sum_function(result));
+  }
+
+  bool sum(size_t begin, size_t end, Type &result, auth_type &auth) const {
+    return this->read_range(begin, end, sum_function(result), auth);
+  }
+
+  //@}
+
+  /** @name Authorization
+   *
+   */
+  //@{
+
+  /*! Get a new authorization object.*/
+  auth_type get_new_auth() const {
+    return protected_array::new_auth();
+  }
+
+  /*! Get a new authorization object.*/
+  static auth_type new_auth() {
+    return auth_type(new auth_base_type);
+  }
+
+  /*! Get the order that element 'index' will be locked with.*/
+  order_type get_order(size_t index) const {
+    return locks[index / block_size].get_order();
+  }
+
+  /*! Check if two elements are protected by the same lock.*/
+  bool same_block(size_t left, size_t right) const {
+    return left / block_size == right / block_size;
+  }
+
+  //@}
+
+  size_t size() const {
+    return values.size();
+  }
+
+  /*! Get the number of elements per lock, after rounding up.*/
+  size_t get_block_size() const {
+    return block_size;
+  }
+
+private:
+  //NOTE: this is the usual size, but nothing breaks if it's wrong
+  enum { cache_line = 64 };
+
+  /*! Fixed-capacity array, starting on a cache line.*/
+  template <class Element>
+  class aligned_array {
+  public:
+    explicit aligned_array(size_t new_capacity) :
+      storage(new char [new_capacity * sizeof(Element) + cache_line]), data(NULL),
+      count(0), capacity_value(new_capacity) {
+      const uintptr_t offset = reinterpret_cast <uintptr_t> (storage.get()) % cache_line;
+      data = reinterpret_cast <Element*> (storage.get() + (offset? cache_line - offset : 0));
+    }
+
+    //(elements are constructed in place at 'next_slot', followed by 'added')
+    void *next_slot() { return data + count; }
+    void added() { ++count; }
+
+    Element &operator [] (size_t index) const { return data[index]; }
+
+    size_t size()     const { return count; }
+    size_t capacity() const { return capacity_value; }
+
+    ~aligned_array() {
+      while (count) data[--count].~Element();
+    }
+
+  private:
+    aligned_array(const aligned_array&);
+    aligned_array &operator = (const aligned_array&);
+
+    std::unique_ptr <char[]> storage;
+    Element                 *data;
+    size_t                   count, capacity_value;
+  };
+
+  static size_t aligned_block_size(size_t requested) {
+    //(the fewest elements that fill a whole number of cache lines)
+    size_t left = sizeof(Type), right = cache_line;
+    while (right) {
+      const size_t remainder = left % right;
+      left  = right;
+      right = remainder;
+    }
+    const size_t unit = cache_line / left;
+    return (requested? (requested + unit - 1) / unit : 1) * unit;
+  }
+
+  struct copy_function {
+    explicit copy_function(Type *new_output) : output(new_output) {}
+
+    void operator () (const Type *input, size_t count) const {
+      for (size_t i = 0; i < count; i++) output[i] = input[i];
+    }
+
+    Type *const output;
+  };
+
+  struct sum_function {
+    explicit sum_function(Type &new_result) : result(new_result) {}
+
+    void operator () (const Type *input, size_t count) const {
+      //NOTE: independent partial sums let the compiler use SIMD for the main
+      //loop without reassociating floating-point additions
+      Type partial[4] = { Type(), Type(), Type(), Type() };
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4) {
+        partial[0] += input[i];
+        partial[1] += input[i + 1];
+        partial[2] += input[i + 2];
+        partial[3] += input[i + 3];
+      }
+      for (; i < count; i++) partial[0] += input[i];
+      result = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    }
+
+    Type &result;
+  };
+
+  inline write_proxy get_write_common(size_t index, lock_auth_base *auth, bool block) {
+    if (index >= values.size()) return write_proxy();
+    return write_proxy(&values[index], &locks[index / block_size], auth, false, block, NULL);
+  }
+
+  inline read_proxy get_read_common(size_t index, lock_auth_base *auth, bool block) const {
+    if (index >= values.size()) return read_proxy();
+    return read_proxy(&values[index], &locks[index / block_size], auth, true, block, NULL);
+  }
+
+  template <class Func>
+  bool read_range_common(size_t begin, size_t end, Func &func, lock_auth_base *auth) const {
+    if (begin > end || end > values.size()) return false;
+    if (begin == end) return true;
+    //(one proxy per block, all held until 'func' returns)
+    std::vector <read_proxy> reads;
+    reads.reserve((end - 1) / block_size - begin / block_size + 1);
+    for (size_t i = begin / block_size; i <= (end - 1) / block_size; i++) {
+      reads.push_back(this->get_read_common(i * block_size, auth, true));
+      if (!reads.back()) return false;
+    }
+    func(&values[begin], end - begin);
+    return true;
+  }
+
+  const size_t          block_size;
+  aligned_array <Type>  values;
+  aligned_array <Lock>  locks;
+};
+
+} //namespace lc
+
+#endif //lc_protected_array_hpp
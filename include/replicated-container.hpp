@@ -0,0 +1,349 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a container for read-mostly data on hosts with several
+ * NUMA nodes. Rather than every thread reading the same object (which means
+ * that threads on other nodes read remote memory), there's a replica of the
+ * object for each node. Writes are operations that are added to a shared log,
+ * and each replica applies the operations in the log when it's next used, so
+ * reads are served from the local replica. (This is the design known as Node
+ * Replication.)
+ *
+ * NUMA nodes are found by reading "/sys/devices/system/node" (Linux). If that
+ * isn't available, there's a single node.
+ */
+
+#ifndef lc_replicated_container_hpp
+#define lc_replicated_container_hpp
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class numa_nodes
+ *  \brief NUMA topology of the host.
+ */
+
+class numa_nodes {
+public:
+  /*! Get the number of NUMA nodes (at least 1).*/
+  static size_t count();
+
+  /*! Get the node of the CPU that the calling thread is running on.*/
+  static size_t current();
+
+private:
+  struct topology {
+    topology();
+
+    size_t               nodes;
+    std::vector <size_t> cpu_nodes;
+  };
+
+  static const topology &get_topology();
+};
+
+
+/*! \class replicated_container
+ *  \brief Container with a replica of the object for each NUMA node.
+ *
+ * Changes are made by passing an operation to execute. The operation is
+ * appended to a log shared by all replicas, and then it's applied to the
+ * caller's local replica. Other replicas apply it (along with anything else
+ * they haven't applied yet) the next time they're read, while holding the
+ * replica's write lock; other threads on the same node then find the replica
+ * up to date. The log only keeps operations that haven't been applied to every
+ * replica, and every replica is brought up to date if it gets too long.
+ *
+ * The first replica is created by the constructor. Each of the others is
+ * copied from the first when it's first used, by a thread on its own node, so
+ * that its memory is allocated on that node.
+ * \attention Operations are applied once per replica, so they must have the
+ * same effect each time, and they must not depend on anything other than the
+ * object they're passed (e.g., use values captured by copy).
+ * \attention Lock must be default-constructible.
+ */
+
+template <class Type, class Lock = rw_lock>
+class replicated_container {
+private:
+  typedef locking_container <Type, Lock> replica_container;
+  typedef lock_auth <Lock>               auth_base_type;
+
+public:
+  typedef Type                                   type;
+  typedef typename replica_container::read_proxy read_proxy;
+  typedef lock_auth_base::auth_type              auth_type;
+  typedef std::function <void(Type&)>            operation;
+
+  /*! \brief Constructor.
+   *
+   * \param initial initial value of the object.
+   * \param new_replicas number of replicas (the number of NUMA nodes if 0).
+   * \param new_log_limit number of unapplied operations that causes every
+   * replica to be brought up to date.
+   */
+  explicit replicated_container(const Type &initial = Type(), size_t new_replicas = 0,
+    size_t new_log_limit = 1024) :
+    replica_count(new_replicas? new_replicas : numa_nodes::count()),
+    log_limit(new_log_limit? new_log_limit : 1), replicas(new std::atomic <replica*> [replica_count]),
+    log_first(0), log_end(0) {
+    replicas[0] = new replica(initial, 0);
+    for (size_t i = 1; i < replica_count; i++) replicas[i] = NULL;
+  }
+
+private:
+  replicated_container(const replicated_container&);
+  replicated_container &operator = (const replicated_container&);
+
+public:
+  /** @name Accessor Functions
+   *
+   */
+  //@{
+
+  /*! \brief Retrieve a read-only proxy to the local replica.
+   *
+   * The replica is brought up to date first, which might require a write lock.
+   * @see locking_container_base::get_read
+   */
+  inline read_proxy get_read(bool block = true) {
+    replica *local = this->get_local();
+    if (!this->catch_up(local, NULL, block)) return read_proxy();
+    return local->data.get_read(block);
+  }
+
+  inline read_proxy get_read_auth(auth_type &auth, bool block = true) {
+    if (!auth) return read_proxy();
+    replica *local = this->get_local();
+    if (!this->catch_up(local, &auth, block)) return read_proxy();
+    return local->data.get_read_auth(auth, block);
+  }
+
+  /*! \brief Add an operation to the log, and apply it to the local replica.
+   *
+   * The operation is added to the log even if this fails, so it's still
+   * applied to every replica eventually.
+   * \return success or failure (i.e., the local replica's lock was rejected)
+   */
+  bool execute(const operation &op) {
+    return this->execute_common(op, NULL);
+  }
+
+  bool execute(const operation &op, auth_type &auth) {
+    if (!auth) return false;
+    return this->execute_common(op, &auth);
+  }
+
+  /*! \brief Bring every replica up to date.
+   *
+   * \return success or failure (i.e., a lock was rejected)
+   */
+  bool sync() {
+    return this->sync_common(NULL);
+  }
+
+  bool sync(auth_type &auth) {
+    if (!auth) return false;
+    return this->sync_common(&auth);
+  }
+
+  //@}
+
+  /** @name Authorization
+   *
+   */
+  //@{
+
+  /*! Get a new authorization object.*/
+  auth_type get_new_auth() const {
+    return replicated_container::new_auth();
+  }
+
+  /*! Get a new authorization object.*/
+  static auth_type new_auth() {
+    return auth_type(new auth_base_type);
+  }
+
+  //@}
+
+  size_t get_replicas() const {
+    return replica_count;
+  }
+
+  /*! Get the number of operations in the log.*/
+  size_t get_log_size() const {
+    std::lock_guard <std::mutex> local_lock(log_lock);
+    return log.size();
+  }
+
+  ~replicated_container() {
+    for (size_t i = 0; i < replica_count; i++) {
+      delete replicas[i].load();
+    }
+  }
+
+private:
+  typedef std::shared_ptr <const operation> operation_pointer;
+  typedef typename replica_container::write_proxy write_proxy;
+
+  struct replica {
+    replica(const Type &initial, size_t new_applied) : data(initial), applied(new_applied) {}
+
+    replica_container     data;
+    //(log position up to which operations have been applied)
+    std::atomic <size_t>  applied;
+  };
+
+  replica *get_local() {
+    const size_t index = numa_nodes::current() % replica_count;
+    replica *local = replicas[index].load();
+    return local? local : this->create_replica(index);
+  }
+
+  replica *create_replica(size_t index) {
+    //NOTE: the copy is made by the calling thread, which is on the replica's
+    //node, so the copy's memory should be allocated on that node
+    std::lock_guard <std::mutex> local_lock(create_lock);
+    replica *existing = replicas[index].load();
+    if (existing) return existing;
+    replica *source = replicas[0].load();
+    std::unique_ptr <replica> created;
+    {
+      //NOTE: 'applied' can only change while the source is write-locked
+      read_proxy read = source->data.get_read();
+      if (!read) return source;
+      std::lock_guard <std::mutex> local_log_lock(log_lock);
+      created.reset(new replica(*read, source->applied.load()));
+      replicas[index] = created.get();
+    }
+    return created.release();
+  }
+
+  bool execute_common(const operation &op, auth_type *auth) {
+    operation_pointer added(new operation(op));
+    size_t pending = 0;
+    {
+      std::lock_guard <std::mutex> local_lock(log_lock);
+      log.push_back(added);
+      pending = ++log_end - log_first;
+    }
+    if (pending > log_limit) this->sync_common(auth);
+    return this->catch_up(this->get_local(), auth, true);
+  }
+
+  bool sync_common(auth_type *auth) {
+    bool success = true;
+    for (size_t i = 0; i < replica_count; i++) {
+      replica *current = replicas[i].load();
+      if (current) success = this->catch_up(current, auth, true) && success;
+    }
+    return success;
+  }
+
+  bool catch_up(replica *current, auth_type *auth, bool block) {
+    if (current->applied.load() >= log_end.load()) return true;
+    write_proxy write = auth? current->data.get_write_auth(*auth, block) :
+                              current->data.get_write(block);
+    if (!write) return false;
+
+    //NOTE: the operations are copied so that they aren't applied while holding
+    //'log_lock'; the log can't be trimmed past this replica's position
+    std::vector <operation_pointer> pending;
+    const size_t start = current->applied.load();
+    {
+      std::lock_guard <std::mutex> local_lock(log_lock);
+      for (size_t i = start; i < log_end.load(); i++) {
+        pending.push_back(log[i - log_first]);
+      }
+    }
+    for (size_t i = 0; i < pending.size(); i++) {
+      (*pending[i])(*write);
+    }
+    current->applied = start + pending.size();
+    write.clear();
+
+    this->trim_log();
+    return true;
+  }
+
+  void trim_log() {
+    //NOTE: replicas can't be created while this is locked, so the minimum
+    //can't decrease while the log is being trimmed
+    std::lock_guard <std::mutex> local_lock(log_lock);
+    size_t minimum = log_end.load();
+    for (size_t i = 0; i < replica_count; i++) {
+      replica *current = replicas[i].load();
+      if (current && current->applied.load() < minimum) minimum = current->applied.load();
+    }
+    while (log_first < minimum) {
+      log.pop_front();
+      ++log_first;
+    }
+  }
+
+  const size_t                                replica_count, log_limit;
+  std::unique_ptr <std::atomic <replica*>[]> replicas;
+  std::mutex                                  create_lock;
+
+  mutable std::mutex             log_lock;
+  std::deque <operation_pointer> log;
+  //(log position of the first operation in 'log', and of the end of 'log')
+  size_t                         log_first;
+  std::atomic <size_t>           log_end;
+};
+
+} //namespace lc
+
+#endif //lc_replicated_container_hpp
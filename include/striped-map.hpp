@@ -0,0 +1,476 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides a hash map split into stripes, each protected by its own
+ * 'ordered_lock'. Rather than choosing the number of stripes up front, the map
+ * keeps track of how often each stripe is contended, and it splits a stripe in
+ * two when the stripe is contended too often. Only the keys in the stripe
+ * being split are moved, and only that stripe is locked while they're moved,
+ * so the rest of the map stays available. (This is essentially extendible
+ * hashing, with a stripe per bucket.)
+ */
+
+#ifndef lc_striped_map_hpp
+#define lc_striped_map_hpp
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "locks.hpp"
+#include "lock-auth.hpp"
+#include "locking-container.hpp"
+
+namespace lc {
+
+
+/*! \class striped_map
+ *  \brief Hash map with per-stripe locks that splits contended stripes.
+ *
+ * Each stripe holds the keys whose hashes end with the stripe's number, and the
+ * stripe's lock has order 'first_order' plus that number. Splitting a stripe
+ * moves half of its keys to a new stripe with a higher number (and order),
+ * which means that the ordered-lock rules apply to the stripes the same way
+ * they apply to other containers, and the splitting thread never needs more
+ * than the one lock it already holds.
+ *
+ * A stripe is split when at least 'split_contended' of its last 'split_window'
+ * accesses had to wait for its lock, until there are 'max_stripes' stripes.
+ * Stripes can also be split explicitly with split and grow.
+ *
+ * Each function has a variant that takes an auth. object, so that a map can be
+ * used along with other ordered containers; the other variants use an auth.
+ * object that's local to the calling thread, and they must not be called
+ * while that thread holds any other locks from this map.
+ * \attention Functions (e.g., for update) are called while the stripe is
+ * locked, so they must not access the same map.
+ */
+
+template <class Key, class Value, class Lock = rw_lock, class Hash = std::hash <Key> >
+class striped_map {
+public:
+  typedef Key                        key_type;
+  typedef Value                      mapped_type;
+  typedef lock_auth_base::auth_type  auth_type;
+  typedef lock_auth_base::order_type order_type;
+  typedef lock_base::count_type      count_type;
+
+  /*! \brief Constructor.
+   *
+   * \param stripes initial number of stripes (rounded up to a power of 2).
+   * \param max_stripes maximum number of stripes (rounded up to a power of 2).
+   * \param first_order order of stripe 0.
+   * \param new_window number of accesses to a stripe between contention checks.
+   * \param new_contended number of contended accesses per window that causes
+   * the stripe to be split.
+   */
+  explicit striped_map(size_t stripes = 4, size_t max_stripes = 1024,
+    order_type first_order = 1, count_type new_window = 1024, count_type new_contended = 64) :
+    max_depth(0), base_order(first_order? first_order : 1),
+    split_window(new_window? new_window : 1), split_contended(new_contended), hasher(),
+    stripe_count(0), split_count(0) {
+    while (((size_t) 1 << max_depth) < max_stripes) ++max_depth;
+    unsigned int depth = 0;
+    while (((size_t) 1 << depth) < stripes && depth < max_depth) ++depth;
+
+    const size_t slots = (size_t) 1 << max_depth;
+    directory.reset(new std::atomic <stripe*> [slots]);
+    by_number.reset(new std::atomic <stripe*> [slots]);
+    for (size_t i = 0; i < slots; i++) {
+      by_number[i] = (i < ((size_t) 1 << depth))? new stripe(i, depth, base_order + i) : NULL;
+    }
+    for (size_t i = 0; i < slots; i++) {
+      directory[i] = by_number[i & (((size_t) 1 << depth) - 1)].load();
+    }
+    stripe_count = (size_t) 1 << depth;
+  }
+
+private:
+  striped_map(const striped_map&);
+  striped_map &operator = (const striped_map&);
+
+public:
+  /** @name Accessor Functions
+   *
+   */
+  //@{
+
+  /*! \brief Set the value for 'key', adding it if necessary.
+   *
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  bool set(const Key &key, const Value &value) {
+    return this->set(key, value, local_auth());
+  }
+
+  bool set(const Key &key, const Value &value, auth_type &auth) {
+    stripe *current = NULL;
+    write_proxy write = this->get_write(key, auth, current);
+    if (!write) return false;
+    write->entries[key] = value;
+    write.clear();
+    this->check_split(current, auth);
+    return true;
+  }
+
+  /*! \brief Copy the value for 'key' into 'value'.
+   *
+   * \return true if 'key' was found
+   */
+  bool get(const Key &key, Value &value) const {
+    return this->get(key, value, local_auth());
+  }
+
+  bool get(const Key &key, Value &value, auth_type &auth) const {
+    stripe *current = NULL;
+    read_proxy read = this->get_read(key, auth, current);
+    if (!read) return false;
+    typename map_type::const_iterator found = read->entries.find(key);
+    bool exists = found != read->entries.end();
+    if (exists) value = found->second;
+    read.clear();
+    this->check_split(current, auth);
+    return exists;
+  }
+
+  /*! \brief Remove 'key'.
+   *
+   * \return true if 'key' was found
+   */
+  bool erase(const Key &key) {
+    return this->erase(key, local_auth());
+  }
+
+  bool erase(const Key &key, auth_type &auth) {
+    stripe *current = NULL;
+    write_proxy write = this->get_write(key, auth, current);
+    if (!write) return false;
+    bool exists = write->entries.erase(key);
+    write.clear();
+    this->check_split(current, auth);
+    return exists;
+  }
+
+  /*! \brief Call 'func' with the value for 'key', adding it if necessary.
+   *
+   * \return success or failure (i.e., the lock was rejected)
+   */
+  template <class Func>
+  bool update(const Key &key, Func func) {
+    return this->update(key, func, local_auth());
+  }
+
+  template <class Func>
+  bool update(const Key &key, Func func, auth_type &auth) {
+    stripe *current = NULL;
+    write_proxy write = this->get_write(key, auth, current);
+    if (!write) return false;
+    func(write->entries[key]);
+    write.clear();
+    this->check_split(current, auth);
+    return true;
+  }
+
+  /*! \brief Call 'func' with each key and value.
+   *
+   * All stripes are read-locked (in order) before 'func' is first called, so
+   * 'func' sees a consistent snapshot of the map.
+   * \return success or failure (i.e., a lock was rejected)
+   */
+  template <class Func>
+  bool for_each(Func func) const {
+    return this->for_each(func, local_auth());
+  }
+
+  template <class Func>
+  bool for_each(Func func, auth_type &auth) const {
+    std::vector <read_proxy> reads;
+    if (!this->read_all(auth, reads)) return false;
+    for (size_t i = 0; i < reads.size(); i++) {
+      for (typename map_type::const_iterator current = reads[i]->entries.begin();
+           current != reads[i]->entries.end(); ++current) {
+        func(current->first, current->second);
+      }
+    }
+    return true;
+  }
+
+  /*! \brief Get the number of keys.
+   *
+   * \return number of keys, or 0 if a lock was rejected
+   */
+  size_t size() const {
+    return this->size(local_auth());
+  }
+
+  size_t size(auth_type &auth) const {
+    std::vector <read_proxy> reads;
+    if (!this->read_all(auth, reads)) return 0;
+    size_t total = 0;
+    for (size_t i = 0; i < reads.size(); i++) {
+      total += reads[i]->entries.size();
+    }
+    return total;
+  }
+
+  //@}
+
+  /** @name Resharding
+   *
+   */
+  //@{
+
+  /*! \brief Split the stripe holding 'key'.
+   *
+   * \return success or failure (e.g., the stripe can't be split further)
+   */
+  bool split(const Key &key) {
+    return this->split(key, local_auth());
+  }
+
+  bool split(const Key &key, auth_type &auth) {
+    const size_t hash = hasher(key);
+    return this->split_stripe(directory[hash & this->slot_mask()].load(), auth);
+  }
+
+  /*! \brief Split every stripe once, doubling the number of stripes.
+   *
+   * The stripes are split one at a time, so the rest of the map remains
+   * available while each is being split.
+   * \return success or failure (e.g., the stripes can't be split further)
+   */
+  bool grow() {
+    return this->grow(local_auth());
+  }
+
+  bool grow(auth_type &auth) {
+    //(only the stripes that exist now; new stripes come from splitting these)
+    std::vector <stripe*> existing;
+    for (size_t i = 0; i <= this->slot_mask(); i++) {
+      stripe *current = by_number[i].load();
+      if (current) existing.push_back(current);
+    }
+    bool success = true;
+    for (size_t i = 0; i < existing.size(); i++) {
+      success = this->split_stripe(existing[i], auth) && success;
+    }
+    return success;
+  }
+
+  /*! Get the current number of stripes.*/
+  size_t get_stripes() const {
+    return stripe_count.load();
+  }
+
+  /*! Get the number of stripes that have been split.*/
+  size_t get_splits() const {
+    return split_count.load();
+  }
+
+  /*! Get the order of the stripe that currently holds 'key'.*/
+  order_type get_order(const Key &key) const {
+    const size_t hash = hasher(key);
+    return directory[hash & this->slot_mask()].load()->data.get_order();
+  }
+
+  //@}
+
+  /** @name Authorization
+   *
+   */
+  //@{
+
+  /*! Get a new authorization object.*/
+  auth_type get_new_auth() const {
+    return striped_map::new_auth();
+  }
+
+  /*! Get a new authorization object.*/
+  static auth_type new_auth() {
+    return auth_type(new lock_auth <ordered_lock <Lock> >);
+  }
+
+  //@}
+
+  ~striped_map() {
+    for (size_t i = 0; i <= this->slot_mask(); i++) {
+      delete by_number[i].load();
+    }
+  }
+
+private:
+  typedef std::unordered_map <Key, Value, Hash> map_type;
+
+  struct stripe_data {
+    explicit stripe_data(unsigned int new_depth) : depth(new_depth) {}
+
+    map_type     entries;
+    //(the stripe holds the keys whose hashes end with the low 'depth' bits of its number)
+    unsigned int depth;
+  };
+
+  typedef locking_container <stripe_data, ordered_lock <Lock> > container_type;
+  typedef typename container_type::write_proxy write_proxy;
+  typedef typename container_type::read_proxy  read_proxy;
+
+  struct stripe {
+    stripe(size_t new_number, unsigned int depth, order_type order) :
+      number(new_number), data(stripe_data(depth), order), accesses(0), contended(0) {}
+
+    stripe(size_t new_number, stripe_data &&moved, order_type order) :
+      number(new_number), data(std::move(moved), order), accesses(0), contended(0) {}
+
+    const size_t                number;
+    container_type              data;
+    std::atomic <count_type>    accesses, contended;
+  };
+
+  static auth_type &local_auth() {
+    static thread_local auth_type auth(striped_map::new_auth());
+    return auth;
+  }
+
+  size_t slot_mask() const {
+    return ((size_t) 1 << max_depth) - 1;
+  }
+
+  static bool holds(const stripe_data &data, size_t number, size_t hash) {
+    return (hash & (((size_t) 1 << data.depth) - 1)) == number;
+  }
+
+  write_proxy get_write(const Key &key, auth_type &auth, stripe *&current) {
+    const size_t hash = hasher(key);
+    while (true) {
+      current = directory[hash & this->slot_mask()].load();
+      write_proxy write = current->data.get_write_auth(auth, false);
+      if (!write) {
+        //NOTE: this might also be a rejection by 'auth', which is counted anyway
+        ++current->contended;
+        write = current->data.get_write_auth(auth, true);
+      }
+      if (!write) return write;
+      //(the stripe might have been split before it was locked)
+      if (holds(*write, current->number, hash)) return write;
+    }
+  }
+
+  read_proxy get_read(const Key &key, auth_type &auth, stripe *&current) const {
+    const size_t hash = hasher(key);
+    while (true) {
+      current = directory[hash & this->slot_mask()].load();
+      read_proxy read = current->data.get_read_auth(auth, false);
+      if (!read) {
+        ++current->contended;
+        read = current->data.get_read_auth(auth, true);
+      }
+      if (!read) return read;
+      if (holds(*read, current->number, hash)) return read;
+    }
+  }
+
+  bool read_all(auth_type &auth, std::vector <read_proxy> &reads) const {
+    //NOTE: a stripe is only ever split into a stripe with a higher number, and
+    //the new stripe is published before the old one is unlocked, so locking in
+    //order of number can't miss any keys
+    for (size_t i = 0; i <= this->slot_mask(); i++) {
+      stripe *current = by_number[i].load();
+      if (!current) continue;
+      reads.push_back(current->data.get_read_auth(auth));
+      if (!reads.back()) return false;
+    }
+    return true;
+  }
+
+  //NOTE: splitting doesn't change the contents of the map, so it's 'const'
+  void check_split(stripe *current, auth_type &auth) const {
+    count_type accesses = ++current->accesses;
+    if (accesses < split_window) return;
+    //(only one thread checks each window)
+    if (!current->accesses.compare_exchange_strong(accesses, 0)) return;
+    if (current->contended.exchange(0) >= split_contended) {
+      this->split_stripe(current, auth);
+    }
+  }
+
+  bool split_stripe(stripe *current, auth_type &auth) const {
+    write_proxy write = current->data.get_write_auth(auth);
+    if (!write || write->depth >= max_depth) return false;
+
+    //NOTE: the new stripe isn't visible to other threads until it's published
+    //below, so it doesn't need to be locked
+    const unsigned int depth = write->depth;
+    const size_t number = current->number + ((size_t) 1 << depth);
+    stripe_data moved(depth + 1);
+    for (typename map_type::iterator entry = write->entries.begin();
+         entry != write->entries.end();) {
+      if (hasher(entry->first) & ((size_t) 1 << depth)) {
+        moved.entries.insert(std::move(*entry));
+        entry = write->entries.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+    write->depth = depth + 1;
+
+    stripe *added = new stripe(number, std::move(moved), base_order + number);
+    by_number[number] = added;
+    for (size_t i = number; i <= this->slot_mask(); i += (size_t) 1 << (depth + 1)) {
+      directory[i] = added;
+    }
+    ++stripe_count;
+    ++split_count;
+    return true;
+  }
+
+  unsigned int     max_depth;
+  const order_type base_order;
+  const count_type split_window, split_contended;
+  const Hash       hasher;
+
+  //(each key's hash maps directly to a slot here, which points to its stripe)
+  std::unique_ptr <std::atomic <stripe*>[]> directory;
+  //(stripes indexed by number, for locking them in order)
+  std::unique_ptr <std::atomic <stripe*>[]> by_number;
+  mutable std::atomic <size_t> stripe_count, split_count;
+};
+
+} //namespace lc
+
+#endif //lc_striped_map_hpp
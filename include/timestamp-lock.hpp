@@ -0,0 +1,298 @@
+/* This software is released under the BSD License.
+ |
+ | Copyright (c) 2016, Google Inc.
+ | Copyright (c) 2015, Kevin P. Barry [ta0kira@gmail.com]
+ | All rights reserved.
+ |
+ | Redistribution  and  use  in  source  and   binary  forms,  with  or  without
+ | modification, are permitted provided that the following conditions are met:
+ |
+ | - Redistributions of source code must retain the above copyright notice, this
+ |   list of conditions and the following disclaimer.
+ |
+ | - Redistributions in binary  form must reproduce the  above copyright notice,
+ |   this list  of conditions and the following disclaimer in  the documentation
+ |   and/or other materials provided with the distribution.
+ |
+ | - Neither the name  of the  Locking Container Project  nor  the names  of its
+ |   contributors may be  used to endorse or promote products  derived from this
+ |   software without specific prior written permission.
+ |
+ | THIS SOFTWARE IS  PROVIDED BY THE COPYRIGHT HOLDERS AND  CONTRIBUTORS "AS IS"
+ | AND ANY  EXPRESS OR IMPLIED  WARRANTIES,  INCLUDING, BUT  NOT LIMITED TO, THE
+ | IMPLIED WARRANTIES OF  MERCHANTABILITY  AND FITNESS FOR A  PARTICULAR PURPOSE
+ | ARE DISCLAIMED.  IN  NO EVENT SHALL  THE COPYRIGHT  OWNER  OR CONTRIBUTORS BE
+ | LIABLE  FOR  ANY  DIRECT,   INDIRECT,  INCIDENTAL,   SPECIAL,  EXEMPLARY,  OR
+ | CONSEQUENTIAL   DAMAGES  (INCLUDING,  BUT  NOT  LIMITED  TO,  PROCUREMENT  OF
+ | SUBSTITUTE GOODS OR SERVICES;  LOSS  OF USE,  DATA,  OR PROFITS;  OR BUSINESS
+ | INTERRUPTION)  HOWEVER  CAUSED  AND ON  ANY  THEORY OF LIABILITY,  WHETHER IN
+ | CONTRACT,  STRICT  LIABILITY, OR  TORT (INCLUDING  NEGLIGENCE  OR  OTHERWISE)
+ | ARISING IN ANY  WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN  IF ADVISED OF THE
+ | POSSIBILITY OF SUCH DAMAGE.
+ +~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+// Author: Kevin P. Barry [ta0kira@gmail.com] [kevinbarry@google.com]
+
+/* This file provides deadlock prevention based on timestamps, for operations
+ * that lock several containers in no particular order. Each operation's auth.
+ * object gets a timestamp when it's created, and the oldest operation always
+ * wins a conflict. Instead of rejecting a lock because of the locks the caller
+ * already holds (as the other auth. types do), the losing operation is made to
+ * abort, and it can then release its locks and try again with the same
+ * timestamp. Since an operation only gets older as it retries, it's eventually
+ * the oldest, and it can't be made to abort again.
+ */
+
+#ifndef lc_timestamp_lock_hpp
+#define lc_timestamp_lock_hpp
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cancel-token.hpp"
+#include "locks.hpp"
+#include "lock-auth.hpp"
+
+namespace lc {
+
+
+/*! \class lock_auth_timestamp
+ *  \brief Auth. type for \ref timestamp_lock.
+ *
+ * This auth. type never rejects a lock because of the locks the caller holds;
+ * instead, the locks themselves resolve conflicts using the auth.'s timestamp.
+ * When a lock request fails, check aborted: If it's true, the operation lost
+ * a conflict, and it must release all of its locks and then call restart
+ * before trying again.
+ * \attention Use a new auth. object (or call renew) for each new operation;
+ * otherwise, the thread's later operations will all keep the same priority.
+ */
+
+class lock_auth_timestamp : public lock_auth_base {
+public:
+  using lock_auth_base::count_type;
+  using lock_auth_base::order_type;
+  typedef unsigned long long timestamp_type;
+
+  lock_auth_timestamp();
+
+  count_type reading_count() const;
+  count_type writing_count() const;
+
+  /*! Get the timestamp; smaller is older.*/
+  timestamp_type get_timestamp() const;
+
+  /*! Check if the operation has been made to abort.*/
+  bool aborted() const;
+
+  /*! \brief Make the operation abort.
+   *
+   * This can be called from any thread. The next lock request using this
+   * auth. fails, as does a request that's currently waiting. (This is what
+   * \ref timestamp_lock does to the operation that loses a conflict.)
+   */
+  void wound();
+
+  /*! \brief Prepare to retry an aborted operation, keeping the timestamp.
+   *
+   * \attention All locks must be released first.
+   */
+  void restart();
+
+  /*! \brief Start a new operation with a new timestamp.
+   *
+   * \attention All locks must be released first.
+   */
+  void renew();
+
+  /*! Get the token that's cancelled when the operation is made to abort.*/
+  cancel_token get_token() const;
+
+  ~lock_auth_timestamp();
+
+private:
+  lock_auth_timestamp(const lock_auth_timestamp&);
+  lock_auth_timestamp &operator = (const lock_auth_timestamp&);
+
+protected:
+  bool register_auth(lock_data &l);
+  bool test_auth(lock_data &l) const;
+  void release_auth(unlock_data &l);
+
+private:
+  static timestamp_type next_timestamp();
+
+  count_type                      reading, writing;
+  timestamp_type                  timestamp;
+  std::atomic <bool>              is_aborted;
+  //NOTE: this is only replaced while no locks are held, i.e., when no other
+  //thread can be calling 'wound'
+  std::unique_ptr <cancel_source> source;
+};
+
+
+/*! \class timestamp_lock
+ *  \brief Lock object that resolves conflicts using timestamps.
+ *
+ * This lock is the same as Base (first template argument), except that it
+ * keeps track of which operations hold it and which are waiting for it, and it
+ * uses their timestamps (see \ref lock_auth_timestamp) to decide which should
+ * abort when there's a conflict:
+ *
+ * - wound_wait: If an older operation has to wait for a younger one, the
+ *   younger one is made to abort at its next lock request (or while it's
+ *   waiting for another lock). A younger operation just waits for an older one.
+ *
+ * - wait_die: If a younger operation would have to wait for an older one, the
+ *   younger one aborts instead. An older operation just waits for a younger
+ *   one.
+ *
+ * Either way, an operation only ever waits for locks held by operations that
+ * can't wait for it in return, so there are no deadlocks, and the oldest
+ * operation is never made to abort. wound_wait aborts operations less often
+ * when the oldest operations are long, and wait_die never interrupts an
+ * operation that has all of the locks it needs.
+ *
+ * All containers locked by an operation must use timestamp_lock with the same
+ * policy, and an auth. object (a \ref lock_auth_timestamp) is always required.
+ * A second lock on the same container by the same operation is always
+ * rejected.
+ * \attention Waiting for Base's other waiters (e.g., readers waiting behind a
+ * waiting writer with rw_lock) isn't taken into account, which is why w_lock
+ * is the default Base.
+ */
+
+template <class Base = w_lock>
+class timestamp_lock : public Base {
+private:
+  typedef Base base;
+
+public:
+  using typename base::count_type;
+  typedef lock_auth_timestamp::timestamp_type timestamp_type;
+
+  enum policy_type {
+    wound_wait,
+    wait_die
+  };
+
+  explicit timestamp_lock(policy_type new_policy = wound_wait) : policy(new_policy) {}
+
+  count_type lock(lock_auth_base *auth, bool read, bool block = true, bool test = false) {
+    if (test) return this->base::lock(auth, read, block, test);
+    return this->lock_common(auth, read, block);
+  }
+
+  count_type unlock(lock_auth_base *auth, bool read, bool test = false) {
+    if (!test) {
+      std::lock_guard <std::mutex> local_lock(operations_lock);
+      this->remove_operation(holders, auth);
+    }
+    return this->base::unlock(auth, read, test);
+  }
+
+  //NOTE: 'cancel' is only checked before waiting; while waiting, the token
+  //from the auth. is used instead
+  count_type lock_cancel(lock_auth_base *auth, bool read, const cancel_token &cancel,
+    bool test = false) {
+    if (test) return this->base::lock_cancel(auth, read, cancel, test);
+    if (cancel.cancelled()) return -1;
+    return this->lock_common(auth, read, true);
+  }
+
+  policy_type get_policy() const {
+    return policy;
+  }
+
+private:
+  timestamp_lock(const timestamp_lock&);
+  timestamp_lock &operator = (const timestamp_lock&);
+
+  struct operation {
+    lock_auth_timestamp *auth;
+    timestamp_type       timestamp;
+  };
+
+  typedef std::vector <operation> operation_list;
+
+  count_type lock_common(lock_auth_base *auth, bool read, bool block) {
+    lock_auth_timestamp *const current = dynamic_cast <lock_auth_timestamp*> (auth);
+    if (!current || current->aborted()) return -1;
+    const operation self = { current, current->get_timestamp() };
+
+    {
+      std::lock_guard <std::mutex> local_lock(operations_lock);
+      for (typename operation_list::const_iterator held = holders.begin();
+           held != holders.end(); ++held) {
+        if (held->auth == current) return -1;
+      }
+      count_type result = this->base::lock(auth, read, false, false);
+      if (result >= 0) {
+        this->add_holder(self);
+        return result;
+      }
+      if (!block) return -1;
+      for (typename operation_list::const_iterator held = holders.begin();
+           held != holders.end(); ++held) {
+        if (policy == wait_die && held->timestamp < self.timestamp) {
+          //(dies rather than waiting for an older operation)
+          current->wound();
+          return -1;
+        }
+        if (policy == wound_wait && held->timestamp > self.timestamp) {
+          held->auth->wound();
+        }
+      }
+      waiters.push_back(self);
+    }
+
+    //NOTE: this is interrupted if the operation is made to abort while waiting
+    count_type result = this->base::lock_cancel(auth, read, current->get_token(), false);
+
+    std::lock_guard <std::mutex> local_lock(operations_lock);
+    this->remove_operation(waiters, auth);
+    if (result >= 0) this->add_holder(self);
+    return result;
+  }
+
+  //NOTE: 'operations_lock' must be held
+
+  void add_holder(const operation &self) {
+    //NOTE: a waiter that registered after this operation started waiting could
+    //have missed it, so the policy is also checked from the holder's side
+    for (typename operation_list::const_iterator waiting = waiters.begin();
+         waiting != waiters.end(); ++waiting) {
+      if (policy == wound_wait && waiting->timestamp < self.timestamp) {
+        self.auth->wound();
+      }
+      if (policy == wait_die && waiting->timestamp > self.timestamp) {
+        waiting->auth->wound();
+      }
+    }
+    holders.push_back(self);
+  }
+
+  void remove_operation(operation_list &operations, const lock_auth_base *auth) {
+    for (typename operation_list::iterator current = operations.begin();
+         current != operations.end(); ++current) {
+      if (current->auth == auth) {
+        operations.erase(current);
+        return;
+      }
+    }
+  }
+
+  const policy_type policy;
+  std::mutex        operations_lock;
+  operation_list    holders, waiters;
+};
+
+
+template <class Base>
+class lock_auth <timestamp_lock <Base> > : public lock_auth_timestamp {};
+
+} //namespace lc
+
+#endif //lc_timestamp_lock_hpp
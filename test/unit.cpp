@@ -33,10 +33,16 @@
 /* This is a unit test of deadlock prevention. This is based on the Dining
  * Philosophers Problem (http://en.wikipedia.org/wiki/Dining_philosophers_
  * problem). This obviously needs to be documented better.
+ *
+ * Specific behaviors that the philosophers can't check (e.g., what happens
+ * while a lock is waiting) are tested separately by passing a test name as the
+ * only argument.
  */
 
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <thread>
 
 #include <time.h>
 #include <errno.h>
@@ -49,6 +55,7 @@
 #include <sys/time.h>
 
 #include "locking-container.hpp"
+#include "timestamp-lock.hpp"
 //(necessary for non-template source)
 #include "locking-container.inc"
 
@@ -92,6 +99,9 @@ struct philosopher_base {
   virtual protected_chopstick::write_proxy write_left() = 0;
   virtual protected_chopstick::read_proxy  read_right() = 0;
 
+  virtual void restart()       = 0;
+  virtual bool aborted() const = 0;
+
   virtual int get_number()      const = 0;
   virtual int get_left_order()  const = 0;
   virtual int get_right_order() const = 0;
@@ -104,6 +114,8 @@ struct philosopher_base {
   static void *eat_dinner(philosopher_base *self) {
     //TODO: error message
     if (!self || !self->barrier_wait()) exit(ERROR_THREAD);
+    //(only used by 'lc::priority_lock')
+    lc::priority_lock::set_thread_priority(self->get_number() % 3);
 
     for (int retries = 0; true; retries++) {
       //NOTE: this allows everything to remain unlocked briefly, which is what
@@ -112,6 +124,9 @@ struct philosopher_base {
       //out of sync, in case that's causing a de facto deadlock
       if (retries > 0 && (retries + self->get_number() + 1) % 2) self->timed_wait();
 
+      //(only used by 'lc::timestamp_lock', after losing a conflict)
+      self->restart();
+
       //NOTE: this should always succeed if multilocking is used; the return
       //value isn't important, because a 'NULL' should mean that we're not
       //using multilocking
@@ -122,7 +137,11 @@ struct philosopher_base {
       //lock type, locking method, or auth. type, but that should be prevented
       //during argument parsing
       protected_chopstick::write_proxy left = self->write_left();
-      if (!left) exit(ERROR_LOGIC);
+      if (!left) {
+        //(with 'lc::timestamp_lock', the operation might have to abort)
+        if (self->aborted()) continue;
+        exit(ERROR_LOGIC);
+      }
 
       //(increase the chances of a potential deadlock)
       //NOTE: 'true' allows the object to skip the wait (this is the difference
@@ -160,10 +179,19 @@ public:
   philosopher(int n, chopstick_pointer l, chopstick_pointer r, pthread_barrier_t *b,
     lc::lock_auth_base::auth_type a = lc::lock_auth_base::auth_type(),
     lc::shared_meta_lock m = lc::shared_meta_lock(), bool d = true) :
-    number(n), deadlock(d), barrier(b), auth(a), multi(m), left(l), right(r) {
+    number(n), deadlock(d), barrier(b), auth(a), multi(m), left(l), right(r),
+    timestamp(dynamic_cast <lc::lock_auth_timestamp*> (a.get())) {
     assert(left.get() && right.get());
   }
 
+  void restart() {
+    if (this->aborted()) timestamp->restart();
+  }
+
+  bool aborted() const {
+    return timestamp && timestamp->aborted();
+  }
+
   lc::meta_lock::write_proxy lock_multi() {
     //(method 2 : methods 0, 1, & 3)
     return multi? multi->get_write_auth(auth) : lc::meta_lock::write_proxy();
@@ -183,6 +211,8 @@ public:
   }
 
   protected_chopstick::read_proxy read_right() {
+    //(the auth. rejects everything after the operation has been made to abort)
+    if (this->aborted()) return protected_chopstick::read_proxy();
     //NOTE: if the auth. type will always reject the lock, might as well exit
     //TODO: error message
     if (auth && !auth->guess_read_allowed(false, false, right->get_order())) exit(ERROR_LOGIC);
@@ -225,6 +255,7 @@ protected:
   lc::lock_auth_base::auth_type auth;
   lc::shared_meta_lock          multi;
   chopstick_pointer             left, right;
+  lc::lock_auth_timestamp      *timestamp;
 };
 
 
@@ -243,7 +274,10 @@ static void init_philosophers(int lock_method, int auth_type, chopstick_set &cho
 static void start_threads(thread_set &threads, philosopher_set &phils,
   pthread_barrier_t *barrier, int timeout);
 
-static void get_results(thread_set &threads, chopstick_set &chops, pthread_barrier_t *barrier);
+static void get_results(thread_set &threads, chopstick_set &chops, pthread_barrier_t *barrier,
+  int lock_type);
+
+static int run_named_test(const char *name, const char *test);
 
 
 //the program proper
@@ -254,6 +288,8 @@ int main(int argc, char *argv[]) {
 
   //argument parsing
 
+  if (argc == 2) return run_named_test(argv[0], argv[1]);
+
   if (argc != 6 && argc != 7) return print_help(argv[0]);
 
   if (sscanf(argv[1], "%i%c", &thread_count, &error) != 1 || thread_count < 2 || thread_count > 256)
@@ -265,7 +301,7 @@ int main(int argc, char *argv[]) {
   if (sscanf(argv[3], "%i%c", &try_deadlock, &error) != 1 || try_deadlock < 0 || try_deadlock > 1)
     return print_help(argv[0], "invalid deadlock value");
 
-  if (sscanf(argv[4], "%i%c", &lock_type, &error) != 1 || lock_type < 0 || lock_type > 3)
+  if (sscanf(argv[4], "%i%c", &lock_type, &error) != 1 || lock_type < 0 || lock_type > 6)
     return print_help(argv[0], "invalid lock type");
 
   if (sscanf(argv[5], "%i%c", &auth_type, &error) != 1 || auth_type < 0 || auth_type > 4)
@@ -283,6 +319,12 @@ int main(int argc, char *argv[]) {
   if (lock_method == 2 && try_deadlock)
     return print_help(argv[0], "cannot cause a deadlock with multi-locking");
 
+  if ((lock_type >= 5) != (auth_type == 4))
+    return print_help(argv[0], "timestamp locks and timestamp auth. must be used together");
+
+  if (lock_method == 3 && lock_type >= 5)
+    return print_help(argv[0], "cannot use ordered locks with timestamp locks");
+
   //program data
 
   philosopher_set   all_philosophers(thread_count);
@@ -314,7 +356,7 @@ int main(int argc, char *argv[]) {
   start_threads(all_threads, all_philosophers, &barrier, timeout);
 
   //wait for results
-  get_results(all_threads, all_chopsticks, &barrier);
+  get_results(all_threads, all_chopsticks, &barrier, lock_type);
 
   clock_gettime(CLOCK_MONOTONIC, &finish);
 
@@ -335,6 +377,7 @@ int main(int argc, char *argv[]) {
 static int print_help(const char *name, const char *message) {
   if (message) fprintf(stderr, "%s: %s\n", name, message);
   fprintf(stderr, "%s [threads] [lock method] [deadlock?] [lock type] [auth type] (timeout)\n", name);
+  fprintf(stderr, "%s [test name]\n", name);
   fprintf(stderr, "[threads]: number of threads to run (2-256)\n");
   fprintf(stderr, "[lock method]: container locking method to use\n");
   fprintf(stderr, "  0: unsafe (no deadlock prevention)\n");
@@ -348,12 +391,24 @@ static int print_help(const char *name, const char *message) {
   fprintf(stderr, "  0: rw_lock\n");
   fprintf(stderr, "  1: w_lock\n");
   fprintf(stderr, "  2: dumb_lock\n");
+  fprintf(stderr, "  3: adaptive_lock\n");
+  fprintf(stderr, "  4: priority_lock\n");
+  fprintf(stderr, "  5: timestamp_lock (wound_wait)\n");
+  fprintf(stderr, "  6: timestamp_lock (wait_die)\n");
   fprintf(stderr, "[auth type]: type of authorization objects to use\n");
   fprintf(stderr, "  0: rw_lock\n");
   fprintf(stderr, "  1: w_lock\n");
   fprintf(stderr, "  2: ordered_lock <rw_lock>\n");
   fprintf(stderr, "  3: ordered_lock <w_lock>\n");
+  fprintf(stderr, "  4: lock_auth_timestamp\n");
   fprintf(stderr, "(timeout): time (in seconds) to wait for deadlock (default: 1s)\n");
+  fprintf(stderr, "[test name]: a specific test to run\n");
+  fprintf(stderr, "  hybrid: get_two_locks_hybrid takes the multi-lock after a conflict\n");
+  fprintf(stderr, "  cancel-write: cancelling a blocked writer leaves no trace\n");
+  fprintf(stderr, "  cancel-read: cancelling a blocked reader leaves no trace\n");
+  fprintf(stderr, "  wound-wait: an older operation wounds a younger one that's waiting\n");
+  fprintf(stderr, "  wait-die: a younger operation dies rather than waiting\n");
+  fprintf(stderr, "  static-order: get_two_locks_static locks in order; the reverse is rejected\n");
   return ERROR_ARGS;
 }
 
@@ -374,6 +429,11 @@ static void init_chopsticks(int lock_method, int lock_type, chopstick_set &chops
           case 0: chops[i].reset(new lc::locking_container <chopstick, lc::rw_lock>);   break;
           case 1: chops[i].reset(new lc::locking_container <chopstick, lc::w_lock>);    break;
           case 2: chops[i].reset(new lc::locking_container <chopstick, lc::dumb_lock>); break;
+          //NOTE: start the chopsticks out in different modes, since the test is too short for switching
+          case 3: chops[i].reset(new lc::locking_container <chopstick, lc::adaptive_lock> (chopstick(), (lc::adaptive_lock::mode_type) (i % 3))); break;
+          case 4: chops[i].reset(new lc::locking_container <chopstick, lc::priority_lock> ()); break;
+          case 5: chops[i].reset(new lc::locking_container <chopstick, lc::timestamp_lock <> > (chopstick(), lc::timestamp_lock <> ::wound_wait)); break;
+          case 6: chops[i].reset(new lc::locking_container <chopstick, lc::timestamp_lock <> > (chopstick(), lc::timestamp_lock <> ::wait_die));   break;
           default: exit(ERROR_ARGS); break;
         }
         break;
@@ -383,6 +443,8 @@ static void init_chopsticks(int lock_method, int lock_type, chopstick_set &chops
           case 0: chops[i].reset(new lc::locking_container <chopstick, lc::ordered_lock <lc::rw_lock> >   (chopstick(), i + 1)); break;
           case 1: chops[i].reset(new lc::locking_container <chopstick, lc::ordered_lock <lc::w_lock> >    (chopstick(), i + 1)); break;
           case 2: chops[i].reset(new lc::locking_container <chopstick, lc::ordered_lock <lc::dumb_lock> > (chopstick(), i + 1)); break;
+          case 3: chops[i].reset(new lc::locking_container <chopstick, lc::ordered_lock <lc::adaptive_lock> > (chopstick(), i + 1)); break;
+          case 4: chops[i].reset(new lc::locking_container <chopstick, lc::ordered_lock <lc::priority_lock> > (chopstick(), i + 1)); break;
           default: exit(ERROR_ARGS); break;
         }
         break;
@@ -407,6 +469,7 @@ static void init_philosophers(int lock_method, int auth_type, chopstick_set &cho
           case 1: new_auth.reset(new lc::lock_auth <lc::w_lock>);  break;
           case 2: new_auth.reset(new lc::lock_auth <lc::ordered_lock <lc::rw_lock> >); break;
           case 3: new_auth.reset(new lc::lock_auth <lc::ordered_lock <lc::w_lock> >);  break;
+          case 4: new_auth.reset(new lc::lock_auth_timestamp); break;
           default: exit(ERROR_ARGS); break;
         }
         break;
@@ -450,7 +513,8 @@ static void start_threads(thread_set &threads, philosopher_set &phils,
 }
 
 
-static void get_results(thread_set &threads, chopstick_set &chops, pthread_barrier_t *barrier) {
+static void get_results(thread_set &threads, chopstick_set &chops, pthread_barrier_t *barrier,
+  int lock_type) {
   int result = pthread_barrier_wait(barrier);
   //TODO: error message
   if (result != 0 && result != PTHREAD_BARRIER_SERIAL_THREAD) exit(ERROR_SYSTEM);
@@ -462,9 +526,219 @@ static void get_results(thread_set &threads, chopstick_set &chops, pthread_barri
   lc::lock_auth_base::auth_type auth(new lc::lock_auth_max);
 
   for (int i = 0; i < (signed) chops.size(); i++) {
+    //(timestamp locks only accept their own auth. type)
+    if (lock_type >= 5) auth = chops[i]->get_new_auth();
     protected_chopstick::read_proxy read = chops[i]->get_read_auth(auth);
     //TODO: error message
     if (!read) exit(ERROR_LOGIC);
     fprintf(stdout, "final:\t%i\t%i\t%i\n", i, read->value, read->retries);
   }
 }
+
+
+//named tests
+
+//wait until 'condition' is true, or give up after about 2s
+template <class Condition>
+static bool wait_for(Condition condition) {
+  for (int i = 0; i < 200; i++) {
+    if (condition()) return true;
+    struct timespec wait = { 0, 10 * 1000 * 1000 };
+    nanosleep(&wait, NULL);
+  }
+  return false;
+}
+
+
+static int test_hybrid() {
+  typedef lc::locking_container <int> container;
+  container object1, object2;
+  lc::meta_lock multi;
+  container::auth_type holder_auth(container::new_auth()), probe_auth(container::new_auth());
+
+  //(causes the non-blocking attempt to fail, and holds a read on the multi-lock)
+  container::write_proxy held = object1.get_write_multi(multi, holder_auth);
+  if (!held) return ERROR_LOGIC;
+
+  std::atomic <bool> finished(false), success(false);
+  std::thread locker([&] {
+    container::auth_type auth(container::new_auth());
+    container::write_proxy write1;
+    container::write_proxy write2;
+    success = lc::get_two_locks_hybrid(object1, object2, write1, write2, auth, multi);
+    finished = true;
+  });
+
+  //NOTE: a write lock on the multi-lock should be waiting for 'held' to be
+  //released, which means that a non-blocking read of the multi-lock should fail
+  bool escalated = wait_for([&] {
+    lc::meta_lock::read_proxy probe = multi.get_read_auth(probe_auth, false);
+    return !probe;
+  });
+  bool blocked = !finished;
+  held.clear();
+  locker.join();
+
+  if (!escalated || !blocked || !success) return ERROR_LOGIC;
+  return SUCCESS;
+}
+
+
+static int test_cancel(bool read) {
+  typedef lc::locking_container <int> container;
+  container object;
+  container::auth_type holder_auth(container::new_auth()), auth(container::new_auth());
+  lc::cancel_source source;
+
+  //(a held write blocks a reader, and a held read blocks a writer)
+  container::write_proxy held_write;
+  container::read_proxy  held_read;
+  if (read) held_write = object.get_write_auth(holder_auth);
+  else      held_read  = object.get_read_auth(holder_auth);
+  if (!held_write && !held_read) return ERROR_LOGIC;
+
+  std::atomic <bool> finished(false), success(false);
+  std::thread waiter([&] {
+    lc::cancel_token token = source.get_token();
+    if (read) success = (bool) object.get_read_auth(auth, token);
+    else      success = (bool) object.get_write_auth(auth, token);
+    finished = true;
+  });
+
+  //NOTE: there's no way to check that 'waiter' is actually waiting, but it
+  //should be by now
+  struct timespec wait = { 0, 100 * 1000 * 1000 };
+  nanosleep(&wait, NULL);
+  bool blocked = !finished;
+  source.cancel();
+  waiter.join();
+
+  //(the auth. must not count the cancelled lock)
+  if (!blocked || success || auth->reading_count() || auth->writing_count()) return ERROR_LOGIC;
+
+  //(the lock must not still count the cancelled waiter)
+  held_write.clear();
+  held_read.clear();
+  if (!object.get_write_auth(auth, false)) return ERROR_LOGIC;
+  if (auth->reading_count() || auth->writing_count()) return ERROR_LOGIC;
+  return SUCCESS;
+}
+
+
+static int test_wound_wait() {
+  typedef lc::locking_container <int, lc::timestamp_lock <> > container;
+  container object1(0, lc::timestamp_lock <> ::wound_wait), object2(0, lc::timestamp_lock <> ::wound_wait);
+  //(the first auth. created is the oldest)
+  lc::lock_auth_timestamp *older   = new lc::lock_auth_timestamp;
+  lc::lock_auth_timestamp *younger = new lc::lock_auth_timestamp;
+  container::auth_type older_auth(older), younger_auth(younger);
+
+  container::write_proxy held2 = object2.get_write_auth(older_auth);
+  if (!held2) return ERROR_LOGIC;
+
+  std::atomic <bool> locked1(false), success(true);
+  std::thread locker([&] {
+    container::write_proxy held1 = object1.get_write_auth(younger_auth);
+    locked1 = (bool) held1;
+    //NOTE: a younger operation waits for an older one, until it's wounded
+    success = (bool) object2.get_write_auth(younger_auth);
+  }); //<-- 'held1' is released here
+
+  if (!wait_for([&] { return (bool) locked1; })) return ERROR_LOGIC;
+  //(give 'locker' time to start waiting for 'object2')
+  struct timespec wait = { 0, 100 * 1000 * 1000 };
+  nanosleep(&wait, NULL);
+
+  //NOTE: this wounds 'younger', which interrupts its wait for 'object2'
+  container::write_proxy held1 = object1.get_write_auth(older_auth);
+  locker.join();
+
+  if (!held1 || success || !younger->aborted() || older->aborted()) return ERROR_LOGIC;
+  return SUCCESS;
+}
+
+
+static int test_wait_die() {
+  typedef lc::locking_container <int, lc::timestamp_lock <> > container;
+  container object1(0, lc::timestamp_lock <> ::wait_die), object2(0, lc::timestamp_lock <> ::wait_die);
+  //(the first auth. created is the oldest)
+  lc::lock_auth_timestamp *older   = new lc::lock_auth_timestamp;
+  lc::lock_auth_timestamp *younger = new lc::lock_auth_timestamp;
+  container::auth_type older_auth(older), younger_auth(younger);
+
+  container::write_proxy held1 = object1.get_write_auth(older_auth);
+  if (!held1) return ERROR_LOGIC;
+
+  std::atomic <bool> locked2(false), success(true);
+  std::thread locker([&] {
+    container::write_proxy held2 = object2.get_write_auth(younger_auth);
+    locked2 = (bool) held2;
+    //(give the older operation time to start waiting for 'object2')
+    struct timespec wait = { 0, 100 * 1000 * 1000 };
+    nanosleep(&wait, NULL);
+    //NOTE: a younger operation dies rather than waiting for an older one
+    success = (bool) object1.get_write_auth(younger_auth);
+  }); //<-- 'held2' is released here
+
+  if (!wait_for([&] { return (bool) locked2; })) return ERROR_LOGIC;
+
+  //NOTE: an older operation waits for a younger one
+  container::write_proxy held2 = object2.get_write_auth(older_auth);
+  locker.join();
+
+  if (!held2 || success || !younger->aborted() || older->aborted()) return ERROR_LOGIC;
+  return SUCCESS;
+}
+
+
+static int test_static_order() {
+  typedef lc::locking_container <int, lc::static_ordered_lock <1> > low_container;
+  typedef lc::locking_container <int, lc::static_ordered_lock <2> > high_container;
+  low_container  low;
+  high_container high;
+  lc::lock_auth_base::auth_type auth(low_container::new_auth()),
+                                holder_auth(low_container::new_auth());
+  low_container::write_proxy  write_low;
+  high_container::write_proxy write_high;
+
+  if (!lc::get_two_locks_static(low, high, write_low, write_high, auth)) return ERROR_LOGIC;
+  if (auth->writing_count() != 2) return ERROR_LOGIC;
+  write_low.clear();
+  write_high.clear();
+  if (auth->writing_count()) return ERROR_LOGIC;
+
+  //NOTE: the reverse order doesn't compile, e.g.:
+  //  lc::get_two_locks_static(high, low, write_high, write_low, auth);
+  //fails with "the first container must have the lower order"
+
+  //(the order is only enforced if the lower-order container is in use)
+  low_container::write_proxy held = low.get_write_auth(holder_auth);
+  if (!held) return ERROR_LOGIC;
+  write_high = high.get_write_auth(auth);
+  if (!write_high) return ERROR_LOGIC;
+  //NOTE: this must be rejected rather than block, since waiting for a lower
+  //order while holding a higher one could cause a deadlock
+  write_low = low.get_write_auth(auth);
+  if (write_low || auth->writing_count() != 1) return ERROR_LOGIC;
+
+  //(the lock rejected above must still be usable)
+  write_high.clear();
+  held.clear();
+  if (!lc::get_two_locks_static(low, high, write_low, write_high, auth, false)) return ERROR_LOGIC;
+  return SUCCESS;
+}
+
+
+static int run_named_test(const char *name, const char *test) {
+  //(in case a test deadlocks)
+  signal(SIGALRM, &deadlock_timeout);
+  struct itimerval timer = { { 0, 0 }, { 10, 0 } };
+  if (setitimer(ITIMER_REAL, &timer, NULL) != 0) return ERROR_SYSTEM;
+  if (strcmp(test, "hybrid") == 0)       return test_hybrid();
+  if (strcmp(test, "cancel-write") == 0) return test_cancel(false);
+  if (strcmp(test, "cancel-read") == 0)  return test_cancel(true);
+  if (strcmp(test, "wound-wait") == 0)   return test_wound_wait();
+  if (strcmp(test, "wait-die") == 0)     return test_wait_die();
+  if (strcmp(test, "static-order") == 0) return test_static_order();
+  return print_help(name, "invalid test name");
+}
@@ -5,8 +5,9 @@ prog='./unit'
 threads='2 4 8 16 256'
 methods='0 1 2 3'
 deadlocks='0 1'
-locks='0 1 2'
-auths='0 1 2 3'
+locks='0 1 2 3 4 5 6'
+auths='0 1 2 3 4'
+tests='hybrid cancel-write cancel-read wound-wait wait-die static-order'
 
 method_names=(
   'unsafe'
@@ -19,6 +20,10 @@ lock_names=(
   'rw_lock'
   'w_lock'
   'dumb_lock'
+  'adaptive_lock'
+  'priority_lock'
+  'timestamp_lock (wound_wait)'
+  'timestamp_lock (wait_die)'
 )
 
 deadlock_names=(
@@ -31,6 +36,7 @@ auth_names=(
   'w_lock'
   'ordered_lock <rw_lock>'
   'ordered_lock <w_lock>'
+  'lock_auth_timestamp'
   '(none)'
 )
 
@@ -56,6 +62,11 @@ expected_result() {
   [ "$m" -eq 3 ] && [ "$a" -lt 2 ] && return 1
   #trying to cause a deadlock with multi-locking
   [ "$m" -eq 2 ] && [ "$d" -ne 0 ] && return 1
+  #timestamp locks without timestamp auth., or vice versa
+  [ "$l" -ge 5 ] && [ "$a" -ne 4 ] && return 1
+  [ "$l" -lt 5 ] && [ "$a" -eq 4 ] && return 1
+  #ordered timestamp locks
+  [ "$m" -eq 3 ] && [ "$l" -ge 5 ] && return 1
   #unsafe locking
   [ "$m" -eq 0 ] && return 3
   return 0
@@ -94,3 +105,20 @@ for t in $threads; do
     done
   done
 done
+
+for n in $tests; do
+  cmd="$prog $n"
+  label="test: $n"
+  echo "##### $label >>>>>"
+  echo "// $cmd //"
+  $cmd
+  result=$?
+  [ "${exit_names[$result]}" ] && result="${exit_names[$result]}"
+  if [ "$result" = "${exit_names[0]}" ]; then
+    pass='PASSED'
+  else
+    pass='FAILED'
+  fi
+  echo "$pass [exit: $result; expected: ${exit_names[0]}]"
+  echo "<<<<< $label #####"
+done